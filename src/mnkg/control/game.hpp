@@ -2,26 +2,43 @@
 #include "model/mcts/ai.hpp"
 #include "model/mnk/game.hpp"
 #include "view/game.hpp"
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <variant>
 
-// FIXME: When the two players are AI, the game cannot be stopped until the end.
-//        Reason: on_new_turn_() calls itself over and over again from the gui
-//        callback until the game is over. Thus, the GUI event loop freezes.
+// AI moves are searched in the background; each is then posted back to the
+// GUI event loop, which thus stays responsive meanwhile (e.g. AI-vs-AI games
+// can be watched, and closed at any time).
+// The AI also ponders on the humans' turns, focused on their likeliest moves;
+// the subtree of the move played is kept, visits included, for its own turn.
+// Games with the dimensions of a preset are played on its preset_game, whose
+// dimensions are compile-time constants; others on the dynamic mnk::game.
 
 namespace mnkg::control {
 
 enum class player { human, ai };
-class game {
+
+struct game_settings {
+        std::array<player, model::mnk::game::player_count()> players;
+        model::mnk::settings                                 game;
+        std::string                                          title;
+        view::game::style                                    style;
+};
+
+// A game in its window, on a Model game (e.g. mnk::game).
+template <class Model>
+class session {
 public:
-        struct settings {
-                std::array<player, model::mnk::game::player_count()> players;
-                model::mnk::game::settings                           game;
-                std::string                                          title;
-                view::game::style                                    style;
-        };
+        using settings = game_settings;
 
 public:
-        game(settings &&settings) :
+        session(settings &&settings) :
                 model_(std::move(settings.game)),
                 gui_({ .title     = settings.title,
                        .style     = settings.style,
@@ -36,10 +53,11 @@ public:
                 using std::ranges::contains;
                 bool run_mcts = contains(settings.players, player::ai);
                 if (run_mcts) {
-                        using mcts       = model::mcts::ai<decltype(model_)>;
-                        auto concurrency = std::thread::hardware_concurrency();
-                        auto hparams     = mcts::hyperparameters{
-                                    .leaf_parallelization = concurrency,
+                        using mcts       = model::mcts::ai<Model>;
+                        auto concurrency = std::max(
+                            1u, std::thread::hardware_concurrency());
+                        auto hparams     = typename mcts::hyperparameters{
+                                    .tree_parallelization = concurrency,
                         };
                         mcts_ = std::make_unique<mcts>(model_, hparams);
                 }
@@ -47,6 +65,11 @@ public:
                 on_new_turn_();
         }
 
+        ~session()
+        {
+                ai_cancelled_ = true; // then awaited by ai_thinking_
+        }
+
         void
         run()
         {
@@ -54,11 +77,16 @@ public:
         }
 
 private:
-        model::mnk::game                                     model_;
+        Model                                                model_;
         view::game                                           gui_;
-        std::unique_ptr<model::mcts::ai<decltype(model_)> >  mcts_;
+        std::unique_ptr<model::mcts::ai<Model> >             mcts_;
         std::array<player, model::mnk::game::player_count()> players_;
         std::vector<model::mnk::action>                      history_;
+        std::atomic<bool>                                    ai_cancelled_
+            = false;
+        std::future<void>                                    ai_thinking_;
+
+        static constexpr auto think_time = std::chrono::seconds(1);
 
 private:
         void
@@ -86,6 +114,8 @@ private:
                 gui_.set_stone_skin(model_.current_player());
                 if (players_[model_.current_player()] == player::human) {
                         gui_.set_selectable_cells(model_.playable_actions());
+                        if (mcts_)
+                                mcts_->ponder(); // until the game is over
                 } else {
                         gui_.set_selectable_cells({});
                         ai_move_();
@@ -95,16 +125,29 @@ private:
         void
         ai_move_()
         {
-                assert(players_[game_.current_player()] == player::ai);
+                assert(players_[model_.current_player()] == player::ai);
                 assert(mcts_);
-                sleep(1); // let it think
-                play_(mcts_->evaluate());
+                auto think = [this] {
+                        using clock   = std::chrono::steady_clock;
+                        auto deadline = clock::now() + think_time;
+                        mcts_->search_until([this, deadline] {
+                                return ai_cancelled_
+                                       || clock::now() >= deadline;
+                        });
+                        if (ai_cancelled_)
+                                return;
+                        auto move = mcts_->evaluate();
+                        gui_.post([this, move] { play_(move); });
+                };
+                ai_thinking_ = std::async(std::launch::async, think);
         }
 
         void
         on_game_over_()
         {
-                assert(game_.is_over());
+                assert(model_.is_over());
+                if (mcts_)
+                        mcts_->pause();
                 if (is_win(model_.result())) {
                         auto        win = get<model::mnk::win>(model_.result());
                         const auto &line = win.line;
@@ -116,4 +159,45 @@ private:
         }
 };
 
+class game {
+public:
+        using settings = game_settings;
+
+public:
+        game(settings &&settings) :
+                session_(open_(std::move(settings)))
+        {
+        }
+
+        void
+        run()
+        {
+                std::visit([](auto &session) { session->run(); }, session_);
+        }
+
+private:
+        template <model::mnk::preset Preset>
+        using preset_session = session<model::mnk::preset_game<Preset> >;
+
+        std::variant<std::unique_ptr<session<model::mnk::game> >,
+                     std::unique_ptr<preset_session<
+                         model::mnk::preset::tictactoe> >,
+                     std::unique_ptr<preset_session<
+                         model::mnk::preset::connect4> >,
+                     std::unique_ptr<preset_session<
+                         model::mnk::preset::gomoku> > >
+            session_;
+
+        static decltype(session_)
+        open_(settings &&settings)
+        {
+                return model::mnk::visit_game_type(
+                    settings.game, [&]<class Model>(std::type_identity<Model>) {
+                            return decltype(session_)(
+                                std::make_unique<session<Model> >(
+                                    std::move(settings)));
+                    });
+        }
+};
+
 } // namespace mnkg::control
@@ -259,6 +259,8 @@ public:
                         ImGui::Separator();
 
                         if (ImGui::Button("Start game", { -FLT_MIN, 0 })) {
+                                namespace filter
+                                    = model::mnk::play_filter;
                                 control::game::settings settings;
                                 settings.game.board.size = game.board_size;
                                 settings.game.rules
@@ -267,10 +269,8 @@ public:
                                         .overline = game.allow_overline,
                                         .play_filter
                                         = game.gravity
-                                              ? std::make_unique<
-                                                    model::mnk::play_filter::
-                                                        gravity>()
-                                              : nullptr };
+                                              ? filter::any(filter::gravity())
+                                              : filter::any() };
                                 settings.style   = game.style.value;
                                 settings.players = players;
                                 settings.title   = "MNKG Game";
@@ -0,0 +1,350 @@
+// Headless tournament between two MCTS configurations, "a" and "b"; e.g. to
+// measure whether a change improves playing strength per unit of CPU.
+// Features:
+// - Games are played in parallel, each between its own pair of AIs, which
+//   take turns moving first.
+// - Per player hyperparameters; board presets, optionally with a proximity
+//   filter; time or iterations per move.
+// - Reports the win/draw/loss rates of "a", its Elo difference to "b", and
+//   their 95% confidence intervals.
+//
+// Usage: mnkg_arena [--option=value ...]; see print_usage_().
+
+#include "model/mcts/ai.hpp"
+#include "model/mnk/game.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using namespace mnkg::model;
+using ai              = mcts::ai<mnk::game>;
+using hyperparameters = ai::hyperparameters;
+
+struct arena_settings {
+        mnk::game::preset         preset    = mnk::game::preset::tictactoe;
+        size_t                    proximity = 0; // filter range; 0: none
+        size_t                    games     = 100;
+        size_t                    concurrency = 0; // games at once; 0: fit
+        std::chrono::milliseconds move_time{ 100 };
+        size_t move_iterations = 0; // per move, instead of move_time, if set
+        std::array<hyperparameters, 2> players; // "a", "b"
+};
+
+struct tally {
+        size_t wins = 0, draws = 0, losses = 0; // of "a"
+        size_t first_player_wins = 0;
+        std::array<size_t, 2> iterations = {}; // by player ("a", "b")
+        std::array<size_t, 2> moves      = {};
+
+        size_t
+        games() const
+        {
+                return wins + draws + losses;
+        }
+};
+
+void
+print_usage_()
+{
+        std::cerr
+            << "Usage: mnkg_arena [--option=value ...]\n"
+               "  --preset=tictactoe|connect4|gomoku   (tictactoe)\n"
+               "  --proximity=R     moves within R of a stone (off)\n"
+               "  --games=N                            (100)\n"
+               "  --concurrency=N   games at once\n"
+               "                    (cores / (threads * roots * leaves))\n"
+               "  --move-time=MS    per move           (100)\n"
+               "  --move-iterations=N  per move, instead of a time\n"
+               "Hyperparameters, of both players, or of one with the a. or "
+               "b. prefix\n"
+               "(e.g. --a.exploration=1.2):\n"
+               "  --threads=N  --roots=N  --leaves=N  --virtual-loss=N\n"
+               "  --exploration=X  --max-depth=N  --memory=MiB (256)\n"
+               "  --table=N  --pruning=X  --early-termination=0|1\n";
+}
+
+template <class Number>
+Number
+parse_(std::string_view text)
+{
+        Number value;
+        auto [end, error] = std::from_chars(
+            text.data(), text.data() + text.size(), value);
+        if (error != std::errc() || end != text.data() + text.size())
+                throw std::invalid_argument("invalid number: "
+                                            + std::string(text));
+        return value;
+}
+
+// A thread count: positive.
+size_t
+parse_count_(std::string_view text)
+{
+        auto value = parse_<size_t>(text);
+        if (!value)
+                throw std::invalid_argument("invalid count: "
+                                            + std::string(text));
+        return value;
+}
+
+void
+set_hyperparameter_(hyperparameters &hparams, std::string_view name,
+                    std::string_view value)
+{
+        if (name == "threads")
+                hparams.tree_parallelization = parse_count_(value);
+        else if (name == "roots")
+                hparams.root_parallelization = parse_count_(value);
+        else if (name == "leaves")
+                hparams.leaf_parallelization = parse_count_(value);
+        else if (name == "virtual-loss")
+                hparams.virtual_loss = parse_<size_t>(value);
+        else if (name == "exploration")
+                hparams.exploration = parse_<float>(value);
+        else if (name == "max-depth")
+                hparams.max_depth = parse_<size_t>(value);
+        else if (name == "memory")
+                hparams.memory_usage = parse_<size_t>(value) << 20;
+        else if (name == "table")
+                hparams.transposition_table_size = parse_<size_t>(value);
+        else if (name == "pruning")
+                hparams.pruning = parse_<float>(value);
+        else if (name == "early-termination")
+                hparams.early_termination = parse_<int>(value) != 0;
+        else
+                throw std::invalid_argument("unknown option: "
+                                            + std::string(name));
+}
+
+arena_settings
+parse_settings_(int argc, char **argv)
+{
+        auto settings = arena_settings();
+        for (auto &player : settings.players)
+                player.memory_usage = size_t(256) << 20;
+        for (int i = 1; i < argc; ++i) {
+                auto argument = std::string_view(argv[i]);
+                auto equal    = argument.find('=');
+                if (!argument.starts_with("--")
+                    || equal == std::string_view::npos)
+                        throw std::invalid_argument("invalid argument: "
+                                                    + std::string(argument));
+                auto name  = argument.substr(2, equal - 2);
+                auto value = argument.substr(equal + 1);
+                if (name == "preset") {
+                        using enum mnk::game::preset;
+                        if (value == "tictactoe")
+                                settings.preset = tictactoe;
+                        else if (value == "connect4")
+                                settings.preset = connect4;
+                        else if (value == "gomoku")
+                                settings.preset = gomoku;
+                        else
+                                throw std::invalid_argument(
+                                    "unknown preset: " + std::string(value));
+                } else if (name == "proximity") {
+                        settings.proximity = parse_<size_t>(value);
+                } else if (name == "games") {
+                        settings.games = parse_<size_t>(value);
+                } else if (name == "concurrency") {
+                        settings.concurrency = parse_<size_t>(value);
+                } else if (name == "move-time") {
+                        settings.move_time = std::chrono::milliseconds(
+                            parse_<size_t>(value));
+                } else if (name == "move-iterations") {
+                        settings.move_iterations = parse_<size_t>(value);
+                } else if (name.starts_with("a.")) {
+                        set_hyperparameter_(
+                            settings.players[0], name.substr(2), value);
+                } else if (name.starts_with("b.")) {
+                        set_hyperparameter_(
+                            settings.players[1], name.substr(2), value);
+                } else {
+                        for (auto &player : settings.players)
+                                set_hyperparameter_(player, name, value);
+                }
+        }
+        if (settings.proximity
+            && settings.preset == mnk::game::preset::connect4)
+                throw std::invalid_argument(
+                    "connect4 already has a play filter");
+        if (!settings.concurrency) {
+                // Busy threads of an AI, playouts included:
+                auto threads = [](const hyperparameters &hparams) {
+                        return hparams.tree_parallelization
+                               * hparams.root_parallelization
+                               * hparams.leaf_parallelization;
+                };
+                auto per_game = std::max(threads(settings.players[0]),
+                                         threads(settings.players[1]));
+                auto cores    = std::thread::hardware_concurrency();
+                settings.concurrency = std::max<size_t>(1, cores / per_game);
+        }
+        return settings;
+}
+
+// Plays a game; "a" moves first if a_first. Records it.
+void
+play_game_(const arena_settings &settings, bool a_first, tally &record)
+{
+        auto configuration = mnk::configuration(settings.preset);
+        if (settings.proximity)
+                configuration.rules.play_filter
+                    = mnk::play_filter::proximity(settings.proximity);
+        auto game = mnk::game(std::move(configuration));
+        // By player index ("a" or "b"), and by seat (turn order).
+        auto players = std::array<std::unique_ptr<ai>, 2>();
+        for (size_t i = 0; i < players.size(); ++i)
+                players[i] = std::make_unique<ai>(game, settings.players[i]);
+        auto seats = a_first ? std::array{ 0, 1 } : std::array{ 1, 0 };
+
+        auto moves = std::array<size_t, 2>();
+        while (!game.is_over()) {
+                auto  seat   = game.current_player();
+                auto &player = *players[seats[seat]];
+                if (settings.move_iterations)
+                        player.search_iterations(settings.move_iterations);
+                else
+                        player.search_for(settings.move_time);
+                auto action = player.evaluate();
+                game.play(action);
+                for (auto &each : players)
+                        each->advance(action);
+                moves[seats[seat]]++;
+        }
+
+        auto winner = game.winner();
+        record.draws += !winner;
+        if (winner) {
+                bool a_won = seats[*winner] == 0;
+                record.wins += a_won;
+                record.losses += !a_won;
+                record.first_player_wins += *winner == 0;
+        }
+        for (size_t i = 0; i < players.size(); ++i) {
+                record.iterations[i] += players[i]->iterations();
+                record.moves[i] += moves[i];
+        }
+}
+
+// Elo difference for an expected score; none (unbounded) at 0 or 1.
+std::optional<double>
+elo_(double score)
+{
+        if (score <= 0 || score >= 1)
+                return std::nullopt;
+        return -400 * std::log10(1 / score - 1);
+}
+
+void
+print_elo_(std::optional<double> elo)
+{
+        if (elo)
+                std::cout << *elo;
+        else
+                std::cout << "unbounded";
+}
+
+void
+print_report_(const tally &total)
+{
+        const double games = total.games();
+        const double score = (total.wins + total.draws / 2.0) / games;
+        // A perfect score is taken as half a game short of it, so that the
+        // estimate stays finite; its interval then has an unbounded side.
+        const auto clamped
+            = std::clamp(score, 0.5 / games, 1 - 0.5 / games);
+        const auto square = (total.wins + total.draws / 4.0) / games;
+        const auto error
+            = std::sqrt(std::max(0.0, square - clamped * clamped) / games);
+        const auto lower = std::max(0.0, clamped - 1.96 * error);
+        const auto upper = std::min(1.0, clamped + 1.96 * error);
+        auto percent = [games](double count) { return 100 * count / games; };
+
+        std::cout << std::fixed << std::setprecision(1);
+        std::cout << "games: " << total.games()
+                  << "\na: wins " << percent(total.wins) << "%, draws "
+                  << percent(total.draws) << "%, losses "
+                  << percent(total.losses) << "%"
+                  << "\nfirst player wins: "
+                  << percent(total.first_player_wins) << "%"
+                  << "\nscore of a: " << std::setprecision(3) << score
+                  << " [" << lower << ", " << upper << "] (95%)"
+                  << std::setprecision(1) << "\nElo of a - b: ";
+        print_elo_(elo_(clamped));
+        std::cout << " [";
+        print_elo_(elo_(lower));
+        std::cout << ", ";
+        print_elo_(elo_(upper));
+        std::cout << "] (95%)";
+        for (size_t i = 0; i < total.moves.size(); ++i)
+                if (total.moves[i])
+                        std::cout << "\niterations per move of "
+                                  << "ab"[i] << ": "
+                                  << total.iterations[i] / total.moves[i];
+        std::cout << std::endl;
+}
+
+} // namespace
+
+int
+main(int argc, char **argv)
+{
+        auto settings = arena_settings();
+        try {
+                settings = parse_settings_(argc, argv);
+        } catch (const std::exception &error) {
+                std::cerr << error.what() << "\n";
+                print_usage_();
+                return 1;
+        }
+
+        auto total    = tally();
+        auto mutex    = std::mutex(); // guards total
+        auto next     = std::atomic<size_t>(0);
+        auto play_all = [&] {
+                for (auto i = next++; i < settings.games; i = next++) {
+                        auto game = tally();
+                        play_game_(settings, i % 2 == 0, game);
+                        auto lock = std::lock_guard(mutex);
+                        total.wins += game.wins;
+                        total.draws += game.draws;
+                        total.losses += game.losses;
+                        total.first_player_wins += game.first_player_wins;
+                        for (size_t p = 0; p < 2; ++p) {
+                                total.iterations[p] += game.iterations[p];
+                                total.moves[p] += game.moves[p];
+                        }
+                        std::cerr << "\r" << total.games() << "/"
+                                  << settings.games << " games, a: +"
+                                  << total.wins << " =" << total.draws
+                                  << " -" << total.losses << std::flush;
+                }
+        };
+        {
+                auto workers = std::vector<std::jthread>();
+                for (size_t i = 0; i < settings.concurrency; ++i)
+                        workers.emplace_back(play_all);
+        }
+        std::cerr << "\n";
+        if (total.games())
+                print_report_(total);
+}
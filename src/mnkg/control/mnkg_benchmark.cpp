@@ -0,0 +1,451 @@
+// Benchmark suite of the model and search layers; e.g. to track performance
+// regressions over time.
+// Features:
+// - Per preset: mnk::game play, undo and playable_actions (ns/op); random
+//   playouts per second; MCTS iterations per second, at 1 to N threads.
+//   Then the same on its preset_game, of fixed dimensions ("<preset>/fixed").
+// - slab_memory and concurrent_slab_memory allocation and deallocation
+//   (ns/op).
+// - Reproducible: games are scripted from a seeded random generator (the
+//   one of the MCTS), which also seeds the searches.
+// - One warm-up sample, then several timed ones; reports their mean, median,
+//   standard deviation and extremes.
+// - Machine-readable output: JSON (default) or CSV.
+//
+// Usage: mnkg_benchmark [--option=value ...]; see print_usage_().
+
+#include "model/mcts/ai.hpp"
+#include "model/mnk/game.hpp"
+#include "varia/arena_memory.hpp"
+#include "varia/concurrent_slab_memory.hpp"
+#include "varia/random.hpp"
+#include "varia/slab_memory.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using namespace mnkg::model;
+using clock = std::chrono::steady_clock;
+
+struct benchmark_settings {
+        std::uint64_t             seed        = 42;
+        size_t                    samples     = 5;
+        std::chrono::milliseconds sample_time = std::chrono::milliseconds(200);
+        size_t                    max_threads = std::max(
+            1u, std::thread::hardware_concurrency());
+        bool csv = false;
+};
+
+struct measurement {
+        std::string         benchmark;
+        std::string         preset; // if any
+        size_t              threads = 1;
+        std::string         unit;
+        std::vector<double> samples;
+};
+
+// Times parts of the benchmarked code; the rest being set up.
+class stopwatch {
+        clock::time_point start_;
+        clock::duration   elapsed_ = {};
+
+public:
+        void
+        start()
+        {
+                start_ = clock::now();
+        }
+
+        void
+        stop()
+        {
+                elapsed_ += clock::now() - start_;
+        }
+
+        clock::duration
+        elapsed() const
+        {
+                return elapsed_;
+        }
+};
+
+enum class rate {
+        nanoseconds_per_op,
+        ops_per_second,
+};
+
+// Repeats the body, which times itself and returns its operation count,
+// until it took at least the sample time; once to warm up, then per sample.
+measurement
+measure_(const benchmark_settings &settings, measurement info, rate kind,
+         auto &&body)
+{
+        auto sample = [&] {
+                auto   watch = stopwatch();
+                size_t ops   = 0;
+                while (watch.elapsed() < settings.sample_time)
+                        ops += body(watch);
+                auto seconds = std::chrono::duration<double>(watch.elapsed());
+                return kind == rate::nanoseconds_per_op
+                           ? seconds.count() * 1e9 / ops
+                           : ops / seconds.count();
+        };
+        sample(); // warm-up
+        info.unit = kind == rate::nanoseconds_per_op ? "ns/op" : "op/s";
+        for (size_t i = 0; i < settings.samples; ++i)
+                info.samples.push_back(sample());
+        return info;
+}
+
+#if !defined(__GNUC__)
+volatile size_t sink_;
+#endif
+
+// Keeps the compiler from optimizing away unused results.
+void
+keep_(size_t value)
+{
+#if defined(__GNUC__)
+        asm volatile("" : : "r"(value) : "memory");
+#else
+        sink_ = value;
+#endif
+}
+
+// Random games, as action sequences from the start position.
+template <class Game>
+std::vector<std::vector<mnk::action> >
+scripts_(const Game &start, size_t count, mnkg::xoshiro256 &generator)
+{
+        auto scripts = std::vector<std::vector<mnk::action> >(count);
+        auto game    = start;
+        for (auto &script : scripts) {
+                while (!game.is_over()) {
+                        auto action = game.random_playable_action(generator);
+                        game.play(action);
+                        script.push_back(action);
+                }
+                for (auto it = script.rbegin(); it != script.rend(); ++it)
+                        game.undo(*it);
+        }
+        return scripts;
+}
+
+template <class Game>
+void
+benchmark_preset_(const benchmark_settings &settings, mnk::preset preset,
+                  std::string_view name, std::vector<measurement> &results)
+{
+        constexpr size_t game_count = 64; // played side by side
+        const auto       start     = Game(mnk::configuration(preset));
+        auto             generator = mnkg::xoshiro256(settings.seed);
+        const auto       scripts   = scripts_(start, game_count, generator);
+        auto             games     = std::vector<Game>(game_count, start);
+        auto             info  = measurement{ .preset = std::string(name) };
+
+        auto play_all = [&](stopwatch *watch) {
+                size_t ops = 0;
+                if (watch)
+                        watch->start();
+                for (size_t i = 0; i < game_count; ++i)
+                        for (const auto &action : scripts[i]) {
+                                games[i].play(action);
+                                ops++;
+                        }
+                if (watch)
+                        watch->stop();
+                return ops;
+        };
+        auto undo_all = [&](stopwatch *watch) {
+                size_t ops = 0;
+                if (watch)
+                        watch->start();
+                for (size_t i = 0; i < game_count; ++i)
+                        for (auto it = scripts[i].rbegin();
+                             it != scripts[i].rend();
+                             ++it) {
+                                games[i].undo(*it);
+                                ops++;
+                        }
+                if (watch)
+                        watch->stop();
+                return ops;
+        };
+        info.benchmark = "play";
+        results.push_back(measure_(
+            settings, info, rate::nanoseconds_per_op, [&](stopwatch &watch) {
+                    auto ops = play_all(&watch);
+                    undo_all(nullptr);
+                    return ops;
+            }));
+        info.benchmark = "undo";
+        results.push_back(measure_(
+            settings, info, rate::nanoseconds_per_op, [&](stopwatch &watch) {
+                    play_all(nullptr);
+                    return undo_all(&watch);
+            }));
+
+        // Positions at random depths of the scripts.
+        auto positions = std::vector<Game>();
+        for (const auto &script : scripts) {
+                auto game  = start;
+                auto depth = mnkg::uniform_below(generator, script.size());
+                for (size_t i = 0; i < depth; ++i)
+                        game.play(script[i]);
+                positions.push_back(std::move(game));
+        }
+        info.benchmark = "playable_actions";
+        results.push_back(measure_(
+            settings, info, rate::nanoseconds_per_op, [&](stopwatch &watch) {
+                    size_t count = 0;
+                    watch.start();
+                    for (const auto &position : positions)
+                            count += position.playable_actions().size();
+                    watch.stop();
+                    keep_(count);
+                    return positions.size();
+            }));
+
+        info.benchmark = "random_playout";
+        auto game      = start;
+        auto played    = std::vector<mnk::action>();
+        results.push_back(measure_(
+            settings, info, rate::ops_per_second, [&](stopwatch &watch) {
+                    watch.start();
+                    while (!game.is_over()) {
+                            auto action
+                                = game.random_playable_action(generator);
+                            game.play(action);
+                            played.push_back(action);
+                    }
+                    watch.stop();
+                    for (; !played.empty(); played.pop_back())
+                            game.undo(played.back());
+                    return 1;
+            }));
+
+        info.benchmark = "mcts_iteration";
+        for (size_t threads = 1;; threads = std::min(threads * 2,
+                                                     settings.max_threads)) {
+                using ai     = mcts::ai<Game>;
+                info.threads = threads;
+                auto hparams = typename ai::hyperparameters{
+                        .tree_parallelization = threads,
+                        .memory_usage         = size_t(512) << 20,
+                        .early_termination    = false,
+                        .seed                 = settings.seed,
+                };
+                results.push_back(measure_(
+                    settings, info, rate::ops_per_second,
+                    [&](stopwatch &watch) {
+                            auto search = ai(start, hparams); // fresh tree
+                            watch.start();
+                            auto ops = search.search_for(settings.sample_time);
+                            watch.stop();
+                            return ops;
+                    }));
+                if (threads == settings.max_threads)
+                        break;
+        }
+}
+
+void
+benchmark_memory_(const benchmark_settings &settings,
+                  std::vector<measurement> &results)
+{
+        constexpr size_t slab_size  = 256;
+        constexpr size_t slab_count = 4096;
+        auto             slabs      = std::vector<void *>(slab_count);
+        auto             alloc_free = [&](auto &memory, stopwatch &watch) {
+                watch.start();
+                for (auto &slab : slabs)
+                        slab = memory.allocate(slab_size, slab_size);
+                for (auto it = slabs.rbegin(); it != slabs.rend(); ++it)
+                        memory.deallocate(*it, slab_size, slab_size);
+                watch.stop();
+                return 2 * slab_count;
+        };
+
+        auto slab = mnkg::slab_memory<slab_size>(slab_count);
+        results.push_back(measure_(settings,
+                                   { .benchmark = "slab_memory" },
+                                   rate::nanoseconds_per_op,
+                                   [&](stopwatch &watch) {
+                                           return alloc_free(slab, watch);
+                                   }));
+
+        auto arena      = mnkg::arena_memory(2 * slab_count * slab_size);
+        auto concurrent = mnkg::concurrent_slab_memory(
+            slab_size, &arena, slab_size);
+        auto magazine = mnkg::concurrent_slab_memory::magazine(concurrent);
+        results.push_back(measure_(settings,
+                                   { .benchmark = "concurrent_slab_memory" },
+                                   rate::nanoseconds_per_op,
+                                   [&](stopwatch &watch) {
+                                           return alloc_free(magazine, watch);
+                                   }));
+}
+
+struct summary {
+        double mean, median, stddev, min, max;
+
+        summary(std::vector<double> samples)
+        {
+                std::ranges::sort(samples);
+                auto count = double(samples.size());
+                mean = std::accumulate(samples.begin(), samples.end(), 0.0)
+                       / count;
+                auto middle = samples.size() / 2;
+                median      = samples.size() % 2
+                                  ? samples[middle]
+                                  : (samples[middle - 1] + samples[middle]) / 2;
+                auto squares = 0.0;
+                for (auto sample : samples)
+                        squares += (sample - mean) * (sample - mean);
+                stddev = count > 1 ? std::sqrt(squares / (count - 1)) : 0;
+                min    = samples.front();
+                max    = samples.back();
+        }
+};
+
+void
+print_json_(const std::vector<measurement> &results, std::uint64_t seed)
+{
+        std::cout << "{\n  \"seed\": " << seed << ",\n  \"results\": [";
+        for (size_t i = 0; i < results.size(); ++i) {
+                const auto &result = results[i];
+                auto        stats  = summary(result.samples);
+                std::cout << (i ? "," : "") << "\n    {\"benchmark\": \""
+                          << result.benchmark << "\", \"preset\": \""
+                          << result.preset
+                          << "\", \"threads\": " << result.threads
+                          << ", \"unit\": \"" << result.unit
+                          << "\", \"samples\": " << result.samples.size()
+                          << ", \"mean\": " << stats.mean
+                          << ", \"median\": " << stats.median
+                          << ", \"stddev\": " << stats.stddev
+                          << ", \"min\": " << stats.min
+                          << ", \"max\": " << stats.max << "}";
+        }
+        std::cout << "\n  ]\n}" << std::endl;
+}
+
+void
+print_csv_(const std::vector<measurement> &results)
+{
+        std::cout << "benchmark,preset,threads,unit,samples,mean,median,"
+                     "stddev,min,max\n";
+        for (const auto &result : results) {
+                auto stats = summary(result.samples);
+                std::cout << result.benchmark << ',' << result.preset << ','
+                          << result.threads << ',' << result.unit << ','
+                          << result.samples.size() << ',' << stats.mean << ','
+                          << stats.median << ',' << stats.stddev << ','
+                          << stats.min << ',' << stats.max << '\n';
+        }
+        std::cout << std::flush;
+}
+
+void
+print_usage_()
+{
+        std::cerr << "Usage: mnkg_benchmark [--option=value ...]\n"
+                     "  --seed=N          of the scripted games   (42)\n"
+                     "  --samples=N       per benchmark           (5)\n"
+                     "  --sample-time=MS  at least, per sample    (200)\n"
+                     "  --threads=N       at most, for MCTS       (cores)\n"
+                     "  --format=json|csv                         (json)\n";
+}
+
+template <class Number>
+Number
+parse_(std::string_view text)
+{
+        Number value;
+        auto [end, error] = std::from_chars(
+            text.data(), text.data() + text.size(), value);
+        if (error != std::errc() || end != text.data() + text.size())
+                throw std::invalid_argument("invalid number: "
+                                            + std::string(text));
+        return value;
+}
+
+benchmark_settings
+parse_settings_(int argc, char **argv)
+{
+        auto settings = benchmark_settings();
+        for (int i = 1; i < argc; ++i) {
+                auto argument = std::string_view(argv[i]);
+                auto equal    = argument.find('=');
+                if (!argument.starts_with("--")
+                    || equal == std::string_view::npos)
+                        throw std::invalid_argument("invalid argument: "
+                                                    + std::string(argument));
+                auto name  = argument.substr(2, equal - 2);
+                auto value = argument.substr(equal + 1);
+                if (name == "seed")
+                        settings.seed = parse_<std::uint64_t>(value);
+                else if (name == "samples")
+                        settings.samples = parse_<size_t>(value);
+                else if (name == "sample-time")
+                        settings.sample_time = std::chrono::milliseconds(
+                            parse_<size_t>(value));
+                else if (name == "threads")
+                        settings.max_threads = parse_<size_t>(value);
+                else if (name == "format" && value == "json")
+                        settings.csv = false;
+                else if (name == "format" && value == "csv")
+                        settings.csv = true;
+                else
+                        throw std::invalid_argument("invalid argument: "
+                                                    + std::string(argument));
+        }
+        if (!settings.samples || !settings.max_threads)
+                throw std::invalid_argument("samples and threads must be > 0");
+        return settings;
+}
+
+} // namespace
+
+int
+main(int argc, char **argv)
+{
+        auto settings = benchmark_settings();
+        try {
+                settings = parse_settings_(argc, argv);
+        } catch (const std::exception &error) {
+                std::cerr << error.what() << "\n";
+                print_usage_();
+                return 1;
+        }
+
+        auto results = std::vector<measurement>();
+        using enum mnk::preset;
+        benchmark_preset_<mnk::game>(settings, tictactoe, "tictactoe", results);
+        benchmark_preset_<mnk::game>(settings, connect4, "connect4", results);
+        benchmark_preset_<mnk::game>(settings, gomoku, "gomoku", results);
+        benchmark_preset_<mnk::preset_game<tictactoe> >(
+            settings, tictactoe, "tictactoe/fixed", results);
+        benchmark_preset_<mnk::preset_game<connect4> >(
+            settings, connect4, "connect4/fixed", results);
+        benchmark_preset_<mnk::preset_game<gomoku> >(
+            settings, gomoku, "gomoku/fixed", results);
+        benchmark_memory_(settings, results);
+
+        if (settings.csv)
+                print_csv_(results);
+        else
+                print_json_(results, settings.seed);
+}
@@ -9,16 +9,25 @@
 // Note that this interface enforces constraints such as a fixed player count
 // and turn order. This is intentional, as it allows for more efficient
 // algorithms and data structures while still aligning with the project's goals.
+//
+// The interface is dispatched statically on final implementations: its
+// members deduce `this`, so they reach the implementation's overrides
+// directly, and those can be inlined. Only calls through a combinatorial
+// reference or pointer (e.g. a clone) are virtual. See static_combinatorial.
 
 #pragma once
 
 #include <algorithm>
 #include <cassert>
+#include <concepts>
 #include <memory>
+#include <optional>
+#include <random>
 #include <type_traits>
 #include <vector>
 
 #include "player.hpp"
+#include "varia/random.hpp"
 
 namespace mnkg::model::game {
 
@@ -81,47 +90,67 @@ public:
         }
 
         inline std::vector<Action> // factual until next play
-        playable_actions() const
+        playable_actions(this const auto &self)
         {
-                auto actions = playable_actions_();
-                assert(!is_over() || actions.empty());
+                auto actions = self.playable_actions_();
+                assert(!self.is_over() || actions.empty());
                 return actions;
         }
 
-        bool
-        is_over() const
+        // Uniformly random playable action; the game must not be over.
+        // Implementations may shadow it with a non-allocating version.
+        template <std::uniform_random_bit_generator Generator>
+        Action
+        random_playable_action(this const auto &self, Generator &generator)
+        {
+                auto actions = self.playable_actions();
+                assert(!actions.empty());
+                return actions[uniform_below(generator, actions.size())];
+        }
+
+        inline bool
+        is_over(this const auto &self)
         {
-                bool over = is_over_();
-                assert(over == combinatorial::is_over_());
+                bool over = self.is_over_();
+                assert(over == self.combinatorial::is_over_());
                 return over;
         }
 
-        std::optional<player::index>
-        winner() const
+        inline std::optional<player::index>
+        winner(this const auto &self)
         {
-                assert(is_over());
-                return winner_();
+                assert(self.is_over());
+                return self.winner_();
         }
 
         bool
-        is_draw() const
+        is_draw(this const auto &self)
         {
-                return is_over() && !winner().has_value();
+                return self.is_over() && !self.winner().has_value();
         }
 
         inline void
-        play(const action &action)
+        play(this auto &self, const action &action)
         {
-                assert(is_playable(action));
-                play_(action);
-                turn_++;
+                assert(self.is_playable(action));
+                self.play_(action);
+                self.turn_++;
         }
 
-        bool
-        is_playable(const action &action) const
+        // Reverts the last play; which must have been of the given action.
+        inline void
+        undo(this auto &self, const action &action)
+        {
+                assert(self.turn_ > 0);
+                self.turn_--;
+                self.undo_(action);
+        }
+
+        inline bool
+        is_playable(this const auto &self, const action &action)
         {
-                bool playable = is_playable_(action);
-                assert(playable == combinatorial::is_playable_(action));
+                bool playable = self.is_playable_(action);
+                assert(playable == self.combinatorial::is_playable_(action));
                 return playable;
         }
 
@@ -143,6 +172,10 @@ private:
         play_(const action &action)
             = 0;
 
+        virtual void // turn is already reverted; see undo
+        undo_(const action &action)
+            = 0;
+
         virtual bool
         is_over_() const
         {
@@ -150,4 +183,45 @@ private:
         }
 };
 
+// Plays an action for the lifetime of the object (make/unmake idiom).
+template <class Game>
+class scoped_play {
+public:
+        using action = Game::action;
+
+        scoped_play(Game &game, const action &action) :
+                game_(game), action_(action)
+        {
+                game_.play(action_);
+        }
+
+        scoped_play(const scoped_play &) = delete;
+
+        ~scoped_play() { game_.undo(action_); }
+
+private:
+        Game  &game_;
+        action action_;
+};
+
+// Implementations of combinatorial whose interface is statically dispatched;
+// as required by performance-critical generic algorithms (e.g. MCTS).
+// Implementations must befriend combinatorial, which calls their overrides.
+template <class Game, typename Action = typename Game::action>
+concept static_combinatorial
+    = std::derived_from<Game, combinatorial<Action> > && std::is_final_v<Game>
+      && requires(Game &game, const Game &view, const Action &action,
+                  std::minstd_rand &generator) {
+                 { game.play(action) };
+                 { game.undo(action) };
+                 { view.is_over() } -> std::same_as<bool>;
+                 { view.is_playable(action) } -> std::same_as<bool>;
+                 {
+                         view.winner()
+                 } -> std::same_as<std::optional<player::index> >;
+                 {
+                         view.random_playable_action(generator)
+                 } -> std::same_as<Action>;
+         };
+
 } // namespace mnkg::model::game
@@ -1,105 +1,317 @@
 #pragma once
 
-#include "varia/allocate_unique.hpp"
-#include "varia/object_pool_allocator.hpp"
+#include "model/mcts/playout_pool.hpp"
+#include "model/mcts/transposition_table.hpp"
+#include "model/mcts/uct.hpp"
+#include "varia/arena_memory.hpp"
+#include "varia/concurrent_slab_memory.hpp"
+#include "varia/random.hpp"
 #include <algorithm>
-#include <asio/thread_pool.hpp>
+#include <array>
 #include <cassert>
+#include <chrono>
+#include <concepts>
+#include <condition_variable>
 #include <cmath>
-#include <future>
+#include <cstdint>
+#include <limits>
 #include <model/game.hpp>
 #include <model/player.hpp>
 #include <mutex>
+#include <numeric>
 #include <random>
+#include <ranges>
+#include <shared_mutex>
+#include <span>
+#include <stdexcept>
 #include <stop_token>
 #include <thread>
+#include <type_traits>
 
 namespace mnkg::model::mcts {
 
-template <class Game, typename Action = typename Game::action>
-requires std::is_base_of_v<model::game::combinatorial<Action>, Game> class ai {
+// Games identifying their positions by hash; enables transposition sharing.
+template <class Game>
+concept hashable = requires(const Game &game) {
+        { game.hash() } -> std::convertible_to<std::uint64_t>;
+};
+
+// Games encoding their actions in 16 bits (e.g. cell indices); enables
+// storing them compactly in the tree.
+template <class Game>
+concept indexable = requires(const Game                  &game,
+                             const typename Game::action &action,
+                             std::uint16_t                index) {
+        { game.action_index(action) } -> std::same_as<std::uint16_t>;
+        { game.action_at(index) } -> std::same_as<typename Game::action>;
+};
+
+// Random is the generator of simulations and expansions, one per thread.
+template <class Game, typename Action = typename Game::action,
+          seedable_generator Random = xoshiro256>
+requires model::game::static_combinatorial<Game, Action> class ai {
 public:
         struct hyperparameters {
 
-                // How many parallel simulations are run per iteration;
-                // size of the simulation worker (thread) pool.
+                // How many parallel simulations are run per iteration: one
+                // by the search thread, the others by a pool of workers
+                // (that many minus one threads) shared by all of them.
                 size_t leaf_parallelization = 1;
 
+                // How many search threads descend the shared tree at once.
+                // Tree parallelization; combinable with the leaf one.
+                size_t tree_parallelization = 1;
+
+                // Losses temporarily added to each node a search thread is
+                // exploring, to steer the other threads elsewhere.
+                // Only used with tree parallelization.
+                size_t virtual_loss = 1;
+
+                // How many independent trees are searched at once; each has
+                // its own search threads and share of the memory_usage.
+                // Root parallelization; evaluation sums their statistics.
+                size_t root_parallelization = 1;
+
                 // UCT constant
                 float exploration = std::numbers::sqrt2;
 
+                // Factor of the exploration at the root while pondering:
+                // below 1, it concentrates the search on the opponent's
+                // likeliest replies, whose subtrees advance() then keeps.
+                float ponder_exploration = 0.5f;
+
                 // Maximum depth of the search tree.
                 // Limits expansion, not simulation.
                 std::optional<size_t> max_depth = std::nullopt;
 
-                // Size of the memory pre-allocated for constructing nodes.
-                // No further memory is allocated during the search.
+                // Size of the memory reserved for constructing nodes;
+                // committed lazily, as the tree grows, on huge pages where
+                // supported. No further memory is allocated during the search,
+                // but compaction briefly reserves a second, equal, area.
                 // Note: may indirectly cap tree-depth below max_depth.
-                // Note: memory may be wasted if the tree is shallow.
                 std::size_t memory_usage = std::pow(1024, 3) * 2; // 2GiB
+
+                // Node memory recycling, once it is full: fraction of the
+                // tree's nodes pruned, least visited first; their statistics
+                // remain in their parents. 0 freezes the tree instead, until
+                // the next move.
+                float pruning = 0.5f;
+
+                // Principal variations spared by pruning: those of this many
+                // most visited actions, followed down the most visited nodes.
+                size_t spared_variations = 3;
+
+                // Between moves, node memory is compacted once at least this
+                // fraction of it is held by freed nodes; which, being sorted
+                // by size, only serve nodes of their size.
+                float compaction = 0.25f;
+
+                // Entries of the table through which nodes of transposed
+                // positions (reached by different move orders) share their
+                // statistics; 0 disables it. Requires a hashable Game.
+                // Note: allocated per tree, on top of memory_usage.
+                std::size_t transposition_table_size = 0;
+
+                // Whether budgeted searches (search_for, search_iterations)
+                // end as soon as the most visited action can no longer be
+                // overtaken within their budget.
+                bool early_termination = true;
+
+                // One in this many iterations has its phases timed, for
+                // telemetry; 0 times none.
+                size_t timing_period = 16;
+
+                // Seed of the random generators, from which each thread's is
+                // derived; drawn from std::random_device if none. Searches
+                // are reproducible given a seed, a single search thread and
+                // tree, no leaf parallelization, and iteration budgets
+                // without early_termination (whose checks are timed).
+                std::optional<std::uint64_t> seed = std::nullopt;
         };
 
+        // Search telemetry over an interval; see sample_telemetry.
+        struct telemetry {
+                std::chrono::steady_clock::duration interval   = {};
+                size_t                              iterations = 0;
+
+                // Mean time per iteration, by phase; estimated from the
+                // timed iterations (see timing_period).
+                std::chrono::nanoseconds lock_wait     = {}; // shared, on trees
+                std::chrono::nanoseconds select        = {};
+                std::chrono::nanoseconds expand        = {};
+                std::chrono::nanoseconds simulate      = {};
+                std::chrono::nanoseconds backpropagate = {};
+
+                // Mean wait of simulations in the worker pool's queue; and
+                // total wait for exclusive locks (advance, evaluate, ...).
+                std::chrono::nanoseconds queue_latency       = {};
+                std::chrono::nanoseconds exclusive_lock_wait = {};
+
+                // Of the leaves reached, root excluded.
+                double mean_depth = 0;
+                size_t max_depth  = 0;
+
+                // Node memory in bytes, summed over trees, at the end: in
+                // nodes, taken from the arenas, reserved.
+                size_t node_memory_live     = 0;
+                size_t node_memory_used     = 0;
+                size_t node_memory_capacity = 0;
+
+                // Tree reuse by advance(), summed over trees: advances,
+                // those which kept a subtree, and the visits it held.
+                size_t advances        = 0;
+                size_t reused_subtrees = 0;
+                size_t reused_visits   = 0;
+        };
+
+        static constexpr size_t telemetry_history_size = 256;
+
         ai(Game game, hyperparameters hparams = {}) :
-                tree_{ .root = make_node(game) }, hyperparameters_{ hparams },
-                node_memory_{ hparams.memory_usage / sizeof(node) },
-                worker_pool_{ hparams.leaf_parallelization },
-                search_thread_{ [this](std::stop_token stop_token) {
-                        while (!stop_token.stop_requested()) {
-                                iterate_(tree_);
-                        }
-                } }
+                hyperparameters_{ hparams },
+                seed_{ hparams.seed ? *hparams.seed : random_seed_() },
+                playouts_{ hparams.leaf_parallelization - 1,
+                           search_thread_count_(hparams),
+                           hparams.leaf_parallelization,
+                           [this, &hparams](size_t index) {
+                                   auto stream = search_thread_count_(hparams)
+                                                 + index;
+                                   return rollout{ random_(stream) };
+                           } }
         {
                 assert(hparams.leaf_parallelization > 0);
+                assert(hparams.tree_parallelization > 0);
+                assert(hparams.root_parallelization > 0);
                 assert(!hparams.max_depth || *hparams.max_depth > 0);
+                assert(hashable<Game> || !hparams.transposition_table_size);
+                const auto tree_count = hparams.root_parallelization;
+                const auto memory     = hparams.memory_usage / tree_count;
+                const auto table_size = hparams.transposition_table_size;
+                const auto threads    = hparams.tree_parallelization;
+                for (size_t i = 0; i < tree_count; ++i)
+                        trees_.push_back(std::make_unique<tree>(
+                            game, memory, threads, table_size));
+                // Idle until a search is requested; see search_.
+                for (auto &tree : trees_) {
+                        auto search = [this, &tree = *tree](
+                                          std::stop_token stop_token,
+                                          size_t index, size_t thread) {
+                                auto scratch = scratch_space(
+                                    index, thread, random_(thread));
+                                while (await_search_(stop_token)) {
+                                        run_search_(tree, scratch, stop_token);
+                                        leave_search_();
+                                }
+                        };
+                        for (size_t i = 0; i < threads; ++i)
+                                search_threads_.emplace_back(
+                                    search, i, search_threads_.size());
+                }
         }
 
         ~ai() = default;
 
+        // Searches for that many more iterations, or fewer once the choice
+        // is settled (see early_termination); exactly that many otherwise.
+        // Blocks meanwhile.
+        // Returns the number of iterations done.
+        size_t
+        search_iterations(size_t iterations)
+        {
+                auto budget = std::min<size_t>(iterations, unlimited_);
+                return search_(budget, [] { return false; });
+        }
+
+        // Searches for that long, or less once the choice is settled (see
+        // early_termination). Blocks meanwhile.
+        // Returns the number of iterations done.
+        template <class Rep, class Period>
+        size_t
+        search_for(std::chrono::duration<Rep, Period> duration)
+        {
+                using clock   = std::chrono::steady_clock;
+                auto deadline = clock::now()
+                                + std::chrono::duration_cast<clock::duration>(
+                                    duration);
+                auto is_over = [deadline] { return clock::now() >= deadline; };
+                return search_(unlimited_, is_over, deadline);
+        }
+
+        // Searches until the predicate, polled every poll_period, holds.
+        // Blocks meanwhile. Returns the number of iterations done.
+        template <std::predicate Predicate>
+        size_t
+        search_until(Predicate done)
+        {
+                return search_(unlimited_, std::move(done));
+        }
+
+        // Searches in the background (e.g. on the opponent's time) until
+        // paused; budgeted searches take over meanwhile, then resume it.
+        // Focused on the likeliest root actions; see ponder_exploration.
+        void
+        ponder()
+        {
+                auto lock = std::lock_guard(searcher_mutex_);
+                if (!pondering_.exchange(true))
+                        start_search_(unlimited_, true);
+        }
+
+        // Stops pondering; returns once the search threads are idle.
+        void
+        pause()
+        {
+                auto lock = std::lock_guard(searcher_mutex_);
+                pondering_ = false;
+                stop_search_();
+        }
+
+        bool
+        pondering() const
+        {
+                return pondering_.load();
+        }
+
+        // The most visited root action; or, if none was expanded yet (e.g.
+        // no search, or one that ended before its first iteration), the
+        // first playable one. Throws if the game is over.
         typename Game::action
         evaluate()
         {
-                auto        lock       = std::lock_guard(tree_.mutex);
-                const auto &candidates = tree_.root->children;
-                assert(!candidates.empty());
+                auto votes = votes_(exclusive_lock_);
+                if (votes.empty()) {
+                        auto &tree    = *trees_.front();
+                        auto  lock    = exclusive_lock_(tree);
+                        auto  actions = tree.game.playable_actions();
+                        if (actions.empty())
+                                throw std::logic_error(
+                                    "no playable action to evaluate");
+                        return actions.front();
+                }
                 auto compare = [](const auto &a, const auto &b) {
-                        return a->visits < b->visits;
+                        return a.second < b.second;
                 };
-                const auto &chosen = *std::max_element(
-                    candidates.begin(), candidates.end(), compare);
-                return chosen->action;
+                return std::ranges::max_element(votes, compare)->first;
         }
 
-        void
+        // Moves the root by the action, keeping its subtree if any.
+        // Returns the visits carried over, summed over trees.
+        size_t
         advance(const Game::action &action)
         {
-                auto  lock      = std::lock_guard(tree_.mutex);
-                auto &root      = tree_.root;
-                auto &next      = root->children;
-                auto  is_target = [&action](const auto &node) {
-                        return node->action == action;
-                };
-                auto target = std::find_if(next.begin(), next.end(), is_target);
-                bool found  = target != next.end();
-                if (found) {
-                        // for some fucking reason, this corrupts the deleter
-                        // root = std::move(*target);
-                        auto mid     = std::move(*target);
-                        root         = std::move(mid);
-                        root->parent = nullptr;
-                } else {
-                        root->action = action;
-                        root->game.play(action);
-                        root->visits = 0;
-                        root->payoff = 0;
-                        root->children.clear();
-                        root->untried = root->game.playable_actions();
-                }
+                size_t visits = 0;
+                for (auto &tree : trees_)
+                        visits += advance_(*tree, action);
+                return visits;
         }
 
         size_t
         iterations() const
         {
-                return iteration_count_.load(std::memory_order_relaxed);
+                size_t sum = 0;
+                for (const auto &tree : trees_)
+                        sum += tree->iteration_count.load(
+                            std::memory_order_relaxed);
+                return sum;
         }
 
         size_t
@@ -108,205 +320,1280 @@ public:
                 return iterations() * hyperparameters_.leaf_parallelization;
         }
 
+        // Telemetry since the previous sample, also recorded in the history.
+        // Sampled after each budgeted search, or on demand.
+        telemetry
+        sample_telemetry()
+        {
+                using namespace std::chrono;
+                auto lock   = std::lock_guard(telemetry_mutex_);
+                auto now    = steady_clock::now();
+                auto totals = typename probe::totals();
+                auto sample = telemetry{ .interval = now - telemetry_time_ };
+                for (auto &tree : trees_) {
+                        for (size_t i = 0; i < tree->probe_count; ++i) {
+                                auto &counters = tree->probes[i];
+                                for (size_t m = 0; m < probe::count; ++m)
+                                        totals[m] += counters.values[m].load(
+                                            std::memory_order_relaxed);
+                                sample.max_depth = std::max<size_t>(
+                                    sample.max_depth,
+                                    counters.max_depth.exchange(0));
+                        }
+                        auto  tree_lock = std::shared_lock(tree->mutex);
+                        auto &storage   = *tree->storage;
+                        sample.node_memory_live += storage.live;
+                        sample.node_memory_used += storage.arena.used();
+                        sample.node_memory_capacity
+                            += storage.arena.capacity();
+                }
+                auto delta = [&](size_t measure) {
+                        return totals[measure] - telemetry_totals_[measure];
+                };
+                auto mean = [&](size_t measure, size_t count) {
+                        return nanoseconds(count ? delta(measure) / count : 0);
+                };
+                auto timed        = delta(probe::timed);
+                sample.iterations = delta(probe::iterations);
+                sample.lock_wait  = mean(probe::lock_wait, timed);
+                sample.select     = mean(probe::select, timed);
+                sample.expand     = mean(probe::expand, timed);
+                sample.simulate   = mean(probe::simulate, timed);
+                sample.backpropagate = mean(probe::backpropagate, timed);
+                sample.queue_latency
+                    = mean(probe::queue_latency, delta(probe::queued));
+                sample.exclusive_lock_wait
+                    = nanoseconds(delta(probe::exclusive_lock_wait));
+                sample.mean_depth
+                    = sample.iterations
+                          ? double(delta(probe::depth)) / sample.iterations
+                          : 0;
+                sample.advances        = delta(probe::advances);
+                sample.reused_subtrees = delta(probe::reused_subtrees);
+                sample.reused_visits   = delta(probe::reused_visits);
+
+                telemetry_totals_ = totals;
+                telemetry_time_   = now;
+                telemetry_history_[telemetry_count_++
+                                   % telemetry_history_size]
+                    = sample;
+                return sample;
+        }
+
+        // The latest samples, oldest first.
+        std::vector<telemetry>
+        telemetry_history() const
+        {
+                auto lock  = std::lock_guard(telemetry_mutex_);
+                auto count = std::min(telemetry_count_, telemetry_history_size);
+                auto history = std::vector<telemetry>();
+                for (auto i = telemetry_count_ - count; i < telemetry_count_;
+                     ++i)
+                        history.push_back(
+                            telemetry_history_[i % telemetry_history_size]);
+                return history;
+        }
+
+        // How often blocking searches check their termination conditions.
+        static constexpr auto poll_period = std::chrono::milliseconds(1);
+
 private:
+        struct node;
+        struct tree;
+
+        static constexpr std::int64_t unlimited_
+            = std::numeric_limits<std::int64_t>::max();
+
+        static size_t
+        search_thread_count_(const hyperparameters &hparams)
+        {
+                return hparams.root_parallelization
+                       * hparams.tree_parallelization;
+        }
+
+        static std::uint64_t
+        random_seed_()
+        {
+                auto device = std::random_device();
+                return std::uint64_t(device()) << 32 | device();
+        }
+
+        // Generator of a thread: search threads by index, then the worker
+        // pool's threads (see playouts_).
+        Random
+        random_(size_t stream) const
+        {
+                return Random(derive_seed(seed_, stream));
+        }
+
+        // Actions as stored in nodes; 16-bit if the game allows it.
+        using action_code = std::conditional_t<indexable<Game>,
+                                               std::uint16_t,
+                                               typename Game::action>;
+
+        using visit_count = std::uint32_t;
+
+        struct statistics {
+                std::atomic<visit_count> visits = 0;
+                std::atomic<float>       payoff = 0;
+        };
+
+        // The statistics of a child, wherever they are stored.
+        struct statistics_ref {
+                std::atomic<visit_count> &visits;
+                std::atomic<float>       &payoff;
+        };
+
+        // A node of the tree, as the slot of its parent's children. The
+        // root has no parent; its statistics are stored in the tree.
+        struct location {
+                node  *parent = nullptr;
+                size_t slot   = 0;
+        };
+
+        static action_code
+        encode_(const Game &game, const typename Game::action &action)
+        {
+                if constexpr (indexable<Game>)
+                        return game.action_index(action);
+                else
+                        return action;
+        }
+
+        static typename Game::action
+        decode_(const Game &game, const action_code &code)
+        {
+                if constexpr (indexable<Game>)
+                        return game.action_at(code);
+                else
+                        return code;
+        }
+
+        size_t
+        advance_(tree &tree, const Game::action &action)
+        {
+                auto  lock = exclusive_lock_(tree);
+                auto &root = *tree.root;
+                auto  code = encode_(tree.game, action);
+
+                // Detach the matching subtree, if any, and free the rest:
+                node       *next   = nullptr;
+                visit_count visits = 0;
+                float       payoff = 0;
+                for (size_t slot = 0; slot < root.expanded; ++slot) {
+                        if (root.actions[slot] != code)
+                                continue;
+                        auto stats = statistics_(tree, { &root, slot });
+                        visits     = stats.visits;
+                        payoff     = stats.payoff;
+                        next       = root.children[slot].exchange(nullptr);
+                        break;
+                }
+                {
+                        auto &storage = *tree.storage;
+                        auto  memory  = magazines_(storage.slabs); // batches
+                        destroy_node_(storage, tree.root, memory);
+                }
+                tree.game.play(action);
+
+                tree.root_own.visits = visits; // overridden if shared
+                tree.root_own.payoff = payoff;
+                share_statistics_(tree);
+                auto  &counters = tree.probes[tree.probe_count - 1];
+                size_t reused   = 0;
+                counters.add(probe::advances, 1);
+                if (next) {
+                        next->parent = nullptr;
+                        tree.root    = next;
+                        reused       = tree.root_stats->visits.load();
+                        counters.add(probe::reused_subtrees, 1);
+                        counters.add(probe::reused_visits, reused);
+                } else {
+                        // Nothing kept: start over on fresh node memory.
+                        // The freed blocks are of the old tree's size
+                        // classes, which the new root's may not be among.
+                        const auto &old = *tree.storage;
+                        tree.storage    = std::make_unique<node_storage>(
+                            old.arena.capacity(), old.magazines.size());
+                        tree.root = make_node_(
+                            tree, {}, tree.game, tree.storage->slabs);
+                        if (!tree.root)
+                                throw std::length_error(
+                                    "memory_usage too low for the root");
+                }
+                if (tree.transpositions) // older positions are unreachable
+                        tree.transpositions->set_horizon(tree.game.turn());
+                tree.root_version++;
+
+                // Recycle memory; possibly more of it than before the move.
+                tree.frozen = false;
+                tree.memory_full.store(false, std::memory_order_relaxed);
+                const auto &storage  = *tree.storage;
+                const auto  freed    = storage.arena.used() - storage.live;
+                const auto  capacity = storage.arena.capacity();
+                if (freed >= hyperparameters_.compaction * capacity)
+                        compact_(tree);
+                return reused;
+        }
+
+        // An expanded node, i.e. its children; these are stored as parallel
+        // arrays (struct-of-arrays), right after it, in a single block of
+        // node memory. So selection scans packed floats, and leaves (mere
+        // children) take no memory block of their own.
+        // Children [0, expanded) can be read without locking; the others
+        // are the untried actions, in random order once tried.
         struct node {
+                node               *parent; // null if root
+                size_t              slot;   // in parent
+                size_t              width;  // playable actions
+                std::atomic<size_t> expanded = 0;
+
+                // Guards expansion, and creation of the children's nodes.
+                std::mutex mutex;
 
-                using unique_ptr = std::unique_ptr<
-                    node, alloc_deleter<mnkg::object_pool_allocator<node> > >;
+                // Arrays of `width` elements; see layout.
+                std::atomic<node *>      *children; // null until expanded
+                statistics              **shared;   // null if not hashed
+                std::atomic<float>       *payoffs;
+                std::atomic<visit_count> *visits;
+                action_code              *actions;
 
-                Game::action                       action;
-                Game                               game;
-                size_t                             visits;
-                float                              payoff;
-                node                              *parent;
-                std::vector<node::unique_ptr>      children;
-                std::vector<typename Game::action> untried;
+                // Offsets in the memory block, and its size.
+                struct layout {
+                        size_t children, shared, payoffs, visits, actions;
+                        size_t size;
 
-                node(Game game) : game(game), untried(game.playable_actions())
+                        layout(size_t width, bool shared_statistics)
+                        {
+                                size_t offset = sizeof(node);
+                                auto   place  = [&offset](size_t count,
+                                                       size_t size,
+                                                       size_t alignment) {
+                                        offset = (offset + alignment - 1)
+                                                 / alignment * alignment;
+                                        auto at = offset;
+                                        offset += count * size;
+                                        return at;
+                                };
+                                auto shared_count
+                                    = shared_statistics ? width : 0;
+                                // By decreasing alignment; minimizes padding.
+                                children = place(width,
+                                                 sizeof(std::atomic<node *>),
+                                                 alignof(std::atomic<node *>));
+                                shared   = place(shared_count,
+                                               sizeof(statistics *),
+                                               alignof(statistics *));
+                                payoffs  = place(width,
+                                                sizeof(std::atomic<float>),
+                                                alignof(std::atomic<float>));
+                                visits   = place(
+                                    width,
+                                    sizeof(std::atomic<visit_count>),
+                                    alignof(std::atomic<visit_count>));
+                                actions  = place(width,
+                                                sizeof(action_code),
+                                                alignof(action_code));
+                                size     = offset;
+                        }
+                };
+
+                node(location at, const std::vector<typename Game::action> &
+                                      playable,
+                     const Game &game, const layout &layout,
+                     bool shared_statistics) :
+                        parent(at.parent), slot(at.slot),
+                        width(playable.size())
                 {
+                        locate_arrays_(layout, shared_statistics);
+                        for (size_t i = 0; i < width; ++i) {
+                                std::construct_at(children + i, nullptr);
+                                if (shared)
+                                        std::construct_at(shared + i, nullptr);
+                                std::construct_at(payoffs + i, 0);
+                                std::construct_at(visits + i, 0);
+                                std::construct_at(actions + i,
+                                                  encode_(game, playable[i]));
+                        }
                 }
 
-                node(node &parent, const Game::action &action) :
-                        parent(&parent), action(action), game(parent.game)
+                // Copy, e.g. to another memory block; children not included.
+                node(const node &source, location at, const layout &layout) :
+                        parent(at.parent), slot(at.slot), width(source.width),
+                        expanded(source.expanded.load())
                 {
-                        game.play(action);
-                        untried = game.playable_actions();
+                        locate_arrays_(layout, source.shared != nullptr);
+                        for (size_t i = 0; i < width; ++i) {
+                                std::construct_at(children + i, nullptr);
+                                if (shared)
+                                        std::construct_at(shared + i,
+                                                          source.shared[i]);
+                                std::construct_at(payoffs + i,
+                                                  source.payoffs[i].load());
+                                std::construct_at(visits + i,
+                                                  source.visits[i].load());
+                                std::construct_at(actions + i,
+                                                  source.actions[i]);
+                        }
+                }
+
+                ~node()
+                {
+                        std::destroy_n(actions, width);
+                }
+
+        private:
+                void
+                locate_arrays_(const layout &layout, bool shared_statistics)
+                {
+                        auto *memory = reinterpret_cast<std::byte *>(this);
+                        children     = reinterpret_cast<std::atomic<node *> *>(
+                            memory + layout.children);
+                        shared = shared_statistics
+                                     ? reinterpret_cast<statistics **>(
+                                         memory + layout.shared)
+                                     : nullptr;
+                        payoffs = reinterpret_cast<std::atomic<float> *>(
+                            memory + layout.payoffs);
+                        visits = reinterpret_cast<std::atomic<visit_count> *>(
+                            memory + layout.visits);
+                        actions = reinterpret_cast<action_code *>(
+                            memory + layout.actions);
                 }
         };
 
-        node::unique_ptr
-        make_node(auto &&...args)
+        // Node memory comes in blocks of a few size classes (4 per doubling,
+        // so at most a fifth is lost to rounding up), each class a
+        // concurrent slab memory; all drawing from the tree's arena.
+        static constexpr auto block_sizes = [] {
+                std::array<size_t, 29> sizes;
+                size_t                 i = 0;
+                for (size_t base = 256; base < 32768; base *= 2)
+                        for (size_t quarters = 4; quarters < 8; ++quarters)
+                                sizes[i++] = base * quarters / 4;
+                sizes[i] = 32768;
+                return sizes;
+        }();
+
+        static constexpr size_t block_alignment = 64; // cache line
+
+        static size_t
+        block_class_(size_t size)
+        {
+                auto it = std::ranges::lower_bound(block_sizes, size);
+                if (it == block_sizes.end())
+                        throw std::length_error("node too large");
+                return it - block_sizes.begin();
+        }
+
+        // By size class.
+        using slab_memories = std::vector<
+            std::unique_ptr<mnkg::concurrent_slab_memory> >;
+        using slab_magazines = std::vector<
+            std::unique_ptr<mnkg::concurrent_slab_memory::magazine> >;
+
+        static slab_magazines
+        magazines_(slab_memories &slabs)
+        {
+                using magazine = mnkg::concurrent_slab_memory::magazine;
+                auto magazines = slab_magazines();
+                for (auto &memory : slabs)
+                        magazines.push_back(
+                            std::make_unique<magazine>(*memory));
+                return magazines;
+        }
+
+        // Node memory of a tree: an arena, carved into slab memories by size
+        // class, with a set of magazines of them per search thread.
+        // Replaced as a whole when compacted; see compact_.
+        struct node_storage {
+                mnkg::arena_memory          arena;
+                slab_memories               slabs;
+                std::vector<slab_magazines> magazines; // by search thread
+                std::atomic<size_t>         live = 0;  // bytes, in nodes
+
+                node_storage(size_t capacity, size_t thread_count) :
+                        arena(capacity)
+                {
+                        for (auto size : block_sizes)
+                                slabs.push_back(
+                                    std::make_unique<concurrent_slab_memory>(
+                                        size, &arena, block_alignment));
+                        for (size_t i = 0; i < thread_count; ++i)
+                                magazines.push_back(magazines_(slabs));
+                }
+        };
+
+        // Node of the game position, in a fresh memory block taken from
+        // `memory` (the node memory, or a thread's magazines of it).
+        // Null if the node memory is full.
+        // Deallocation is not synchronized: it requires exclusive access.
+        static node *
+        make_node_(tree &tree, location at, const Game &game, auto &memory)
+        {
+                auto playable = game.playable_actions();
+                bool shared   = tree.transpositions != nullptr;
+                auto layout   = typename node::layout(playable.size(), shared);
+                auto size_class = block_class_(layout.size);
+                void *block;
+                try {
+                        block = memory[size_class]->allocate(
+                            block_sizes[size_class], block_alignment);
+                } catch (const std::bad_alloc &) {
+                        return nullptr; // full
+                }
+                tree.storage->live.fetch_add(block_sizes[size_class],
+                                             std::memory_order_relaxed);
+                return std::construct_at(static_cast<node *>(block),
+                                         at,
+                                         playable,
+                                         game,
+                                         layout,
+                                         shared);
+        }
+
+        // Destroys the node and its descendants, freeing their memory.
+        static void
+        destroy_node_(node_storage &storage, node *target, auto &memory)
+        {
+                if (!target)
+                        return;
+                for (size_t slot = 0; slot < target->expanded; ++slot)
+                        destroy_node_(
+                            storage, target->children[slot], memory);
+                bool shared     = target->shared != nullptr;
+                auto layout     = typename node::layout(target->width, shared);
+                auto size_class = block_class_(layout.size);
+                std::destroy_at(target);
+                memory[size_class]->deallocate(
+                    target, block_sizes[size_class], block_alignment);
+                storage.live.fetch_sub(block_sizes[size_class],
+                                       std::memory_order_relaxed);
+        }
+
+        // Copy of the node and its descendants, in the storage.
+        // Null if it is full.
+        static node *
+        relocate_(const node &source, location at, node_storage &storage)
         {
-                auto allocator
-                    = mnkg::object_pool_allocator<node>(&node_memory_);
-                return allocate_unique<node>(
-                    allocator, std::forward<decltype(args)>(args)...);
+                bool  shared     = source.shared != nullptr;
+                auto  layout     = typename node::layout(source.width, shared);
+                auto  size_class = block_class_(layout.size);
+                void *block;
+                try {
+                        block = storage.slabs[size_class]->allocate(
+                            block_sizes[size_class], block_alignment);
+                } catch (const std::bad_alloc &) {
+                        return nullptr;
+                }
+                storage.live.fetch_add(block_sizes[size_class],
+                                       std::memory_order_relaxed);
+                auto *copy = std::construct_at(
+                    static_cast<node *>(block), source, at, layout);
+                for (size_t slot = 0; slot < copy->expanded; ++slot) {
+                        const auto *child = source.children[slot].load();
+                        if (!child)
+                                continue;
+                        auto *moved
+                            = relocate_(*child, { copy, slot }, storage);
+                        if (!moved) {
+                                destroy_node_(storage, copy, storage.slabs);
+                                return nullptr;
+                        }
+                        copy->children[slot].store(moved);
+                }
+                return copy;
         }
 
+        // Telemetry counters of a search thread, only written by it (but
+        // for exclusive lock waits). Cumulative.
+        struct alignas(64) probe {
+                enum measure : size_t {
+                        iterations,
+                        depth,
+                        timed, // iterations
+                        lock_wait,
+                        select,
+                        expand,
+                        simulate,
+                        backpropagate,
+                        queued, // simulations
+                        queue_latency,
+                        exclusive_lock_wait,
+                        advances,
+                        reused_subtrees,
+                        reused_visits,
+                        count
+                };
+                using totals = std::array<std::uint64_t, count>;
+
+                std::array<std::atomic<std::uint64_t>, count> values = {};
+                std::atomic<std::uint64_t> max_depth = 0; // since sampled
+
+                // By its single writer; cheaper than an atomic addition.
+                void
+                add(measure measure, std::uint64_t value)
+                {
+                        auto &counter = values[measure];
+                        counter.store(
+                            counter.load(std::memory_order_relaxed) + value,
+                            std::memory_order_relaxed);
+                }
+
+                // By any thread.
+                void
+                add_shared(measure measure, std::uint64_t value)
+                {
+                        values[measure].fetch_add(value,
+                                                  std::memory_order_relaxed);
+                }
+        };
+
         struct tree {
-                node::unique_ptr root;
-                std::mutex       mutex;
+                // Declared first to outlive the nodes it holds.
+                std::unique_ptr<node_storage> storage;
+
+                // Null unless enabled; see hyperparameters.
+                std::unique_ptr<transposition_table<statistics> >
+                    transpositions;
+
+                Game        game; // at the root position
+                statistics  root_own;
+                statistics *root_stats = &root_own; // or shared
+                node       *root;                   // never null
+
+                // Iterations share it; evaluation and advancement own it.
+                std::shared_mutex mutex;
+
+                // Pending exclusive locks; search threads back off meanwhile
+                // so that they cannot starve.
+                std::atomic<size_t> exclusive_waiters = 0;
+
+                std::atomic<size_t> iteration_count = 0;
+
+                // Changes whenever the root does; see scratch_space.
+                size_t root_version = 1;
+
+                // Set once a node could not be allocated; see
+                // collect_garbage_. Frozen if that did not help, until the
+                // next move.
+                std::atomic<bool> memory_full = false;
+                bool              frozen      = false;
+
+                // By search thread, then one for exclusive operations.
+                size_t                   probe_count;
+                std::unique_ptr<probe[]> probes;
+
+                tree(const Game &game, size_t memory, size_t thread_count,
+                     size_t table_size) :
+                        storage(std::make_unique<node_storage>(memory,
+                                                               thread_count)),
+                        transpositions(
+                            hashable<Game> && table_size
+                                ? std::make_unique<
+                                    transposition_table<statistics> >(
+                                    table_size)
+                                : nullptr),
+                        game(game), probe_count(thread_count + 1),
+                        probes(std::make_unique<probe[]>(probe_count))
+                {
+                        share_statistics_(*this);
+                        root = make_node_(*this, {}, game, storage->slabs);
+                        if (!root)
+                                throw std::length_error(
+                                    "memory_usage too low for the root");
+                }
+
+                ~tree()
+                {
+                        destroy_node_(*storage, root, storage->slabs);
+                }
         };
 
-        hyperparameters                 hyperparameters_;
-        mnkg::slab_memory<sizeof(node)> node_memory_;
-        tree                            tree_;
-        std::atomic<size_t>             iteration_count_ = { 0 };
-        asio::thread_pool               worker_pool_;
-        std::jthread                    search_thread_;
-
-        float
-        rate_(const node &node)
-        {
-                // UCT (Upper Confidence Bound 1 applied to trees)
-                assert(node.parent);
-                if (node.visits > 0)
-                        return node.payoff / node.visits
-                               + hyperparameters_.exploration
-                                     * std::sqrt(std::log(node.parent->visits)
-                                                 / node.visits);
-                else
-                        return std::numeric_limits<float>::infinity();
+        // Per search thread. Its game is kept at the root position across
+        // iterations, which play on it and then undo their plays; so that
+        // no game is copied per iteration (make/unmake idiom).
+        struct scratch_space {
+                std::optional<Game>                game;
+                size_t                             root_version = 0;
+                std::vector<typename Game::action> played; // to be undone
+                size_t index;  // of the search thread, in its tree
+                size_t thread; // index among all search threads
+                size_t iterations = 0; // by the search thread, for timing
+                Random random;
+
+                scratch_space(size_t index, size_t thread, Random random) :
+                        index(index), thread(thread), random(std::move(random))
+                {
+                }
+        };
+
+        // Playouts of the worker pool; see rollout_.
+        struct rollout {
+                Random random;
+
+                float
+                operator()(Game                               &game,
+                           std::vector<typename Game::action> &played)
+                {
+                        return rollout_(game, played, random);
+                }
+        };
+
+        hyperparameters                      hyperparameters_;
+        std::uint64_t                        seed_; // see random_
+        std::vector<std::unique_ptr<tree> > trees_; // root parallelization
+        playout_pool<Game, rollout>          playouts_; // leaf one
+
+        // Search control: the search threads iterate while searching_,
+        // each claiming an iteration from the budget_ first.
+        std::mutex                  searcher_mutex_; // one search at a time
+        std::mutex                  search_mutex_;   // guards the following
+        std::condition_variable_any search_changed_;
+        std::atomic<bool>           searching_ = false;
+        std::atomic<std::int64_t>   budget_    = 0; // iterations left
+        size_t                      busy_      = 0; // search threads
+        std::atomic<bool>           pondering_ = false;
+        std::atomic<bool>           focused_   = false; // by pondering
+
+        // Telemetry, as of the last sample.
+        mutable std::mutex                    telemetry_mutex_;
+        typename probe::totals                telemetry_totals_ = {};
+        std::chrono::steady_clock::time_point telemetry_time_
+            = std::chrono::steady_clock::now();
+        std::array<telemetry, telemetry_history_size> telemetry_history_;
+        size_t telemetry_count_ = 0;
+
+        std::vector<std::jthread> search_threads_; // destroyed first
+
+        // Runs a search until its budget (of iterations) is spent, or
+        // done(); or earlier, once settled, if it is bounded at all.
+        size_t
+        search_(std::int64_t budget, auto done,
+                std::optional<std::chrono::steady_clock::time_point>
+                    deadline
+                = std::nullopt)
+        {
+                using clock = std::chrono::steady_clock;
+                auto lock   = std::lock_guard(searcher_mutex_);
+                stop_search_(); // pondering, if any
+                const auto start = clock::now();
+                const auto first = iterations();
+                const bool bounded
+                    = hyperparameters_.early_termination
+                      && (budget != unlimited_ || deadline);
+                start_search_(budget);
+                while (!wait_search_end_(poll_period) && !done()) {
+                        if (!bounded)
+                                continue;
+                        // Iterations left, at most:
+                        auto remaining = std::max<std::int64_t>(
+                            budget_.load(std::memory_order_relaxed), 0);
+                        if (deadline) { // at the rate so far
+                                auto   now  = clock::now();
+                                double rate = double(iterations() - first)
+                                              / (now - start).count();
+                                auto   left = std::max(*deadline - now,
+                                                       clock::duration(0));
+                                remaining   = std::min<std::int64_t>(
+                                    remaining, rate * left.count() + 1);
+                        }
+                        if (settled_(remaining))
+                                break;
+                }
+                stop_search_();
+                sample_telemetry();
+                auto count = iterations() - first;
+                if (pondering_)
+                        start_search_(unlimited_, true);
+                return count;
+        }
+
+        void
+        start_search_(std::int64_t budget, bool pondering = false)
+        {
+                {
+                        auto lock = std::lock_guard(search_mutex_);
+                        budget_.store(budget, std::memory_order_relaxed);
+                        focused_.store(pondering, std::memory_order_relaxed);
+                        searching_ = true;
+                }
+                search_changed_.notify_all();
+        }
+
+        // Ends the search; returns once the search threads are idle.
+        void
+        stop_search_()
+        {
+                auto lock  = std::unique_lock(search_mutex_);
+                searching_ = false;
+                search_changed_.notify_all();
+                search_changed_.wait(lock, [this] { return busy_ == 0; });
+        }
+
+        // Whether the search ended (by budget) within the timeout.
+        bool
+        wait_search_end_(std::chrono::steady_clock::duration timeout)
+        {
+                auto lock = std::unique_lock(search_mutex_);
+                return search_changed_.wait_for(
+                    lock, timeout, [this] { return !searching_; });
+        }
+
+        // For search threads: waits for a search; false once stopped.
+        bool
+        await_search_(std::stop_token stop_token)
+        {
+                auto lock = std::unique_lock(search_mutex_);
+                search_changed_.wait(
+                    lock, stop_token, [this] { return searching_.load(); });
+                if (stop_token.stop_requested())
+                        return false;
+                busy_++;
+                return true;
+        }
+
+        // For search threads: iterates while the search lasts.
+        void
+        run_search_(tree &tree, scratch_space &scratch,
+                    std::stop_token stop_token)
+        {
+                constexpr auto relaxed = std::memory_order_relaxed;
+                while (searching_.load(relaxed)
+                       && !stop_token.stop_requested()) {
+                        if (tree.exclusive_waiters.load(relaxed)) {
+                                std::this_thread::yield();
+                                continue;
+                        }
+                        if (budget_.fetch_sub(1, relaxed) <= 0)
+                                return end_search_();
+                        iterate_(tree, scratch);
+                        if (tree.memory_full.load(relaxed))
+                                collect_garbage_(tree);
+                }
+        }
+
+        // For search threads: ends the search, its budget being spent.
+        void
+        end_search_()
+        {
+                {
+                        auto lock  = std::lock_guard(search_mutex_);
+                        searching_ = false;
+                }
+                search_changed_.notify_all();
+        }
+
+        // For search threads: leaves the current search.
+        void
+        leave_search_()
+        {
+                {
+                        auto lock = std::lock_guard(search_mutex_);
+                        busy_--;
+                }
+                search_changed_.notify_all();
+        }
+
+        // Visits per expanded root action, summed across all trees; each
+        // locked with lock(tree) meanwhile.
+        std::vector<std::pair<typename Game::action, size_t> >
+        votes_(auto lock)
+        {
+                std::vector<std::pair<typename Game::action, size_t> > votes;
+                for (auto &tree : trees_) {
+                        auto        guard = lock(*tree);
+                        const auto &root  = *tree->root;
+                        for (size_t slot = 0; slot < root.expanded; ++slot) {
+                                auto action = decode_(tree->game,
+                                                      root.actions[slot]);
+                                auto visits = root.visits[slot].load();
+                                if (root.shared && root.shared[slot])
+                                        visits = root.shared[slot]->visits;
+                                auto is_same = [&action](const auto &vote) {
+                                        return vote.first == action;
+                                };
+                                auto vote = std::ranges::find_if(votes,
+                                                                 is_same);
+                                if (vote != votes.end())
+                                        vote->second += visits;
+                                else
+                                        votes.emplace_back(action, visits);
+                        }
+                }
+                return votes;
+        }
+
+        // Whether the most visited action can no longer be overtaken within
+        // that many iterations.
+        bool
+        settled_(std::int64_t remaining)
+        {
+                auto votes = votes_(
+                    [](tree &tree) { return std::shared_lock(tree.mutex); });
+                if (votes.empty())
+                        return false;
+                // Unexpanded actions, if any, have no visits.
+                size_t best = 0, runner_up = 0;
+                for (const auto &[action, visits] : votes) {
+                        runner_up = std::max(runner_up, std::min(best, visits));
+                        best      = std::max(best, visits);
+                }
+                return std::int64_t(best - runner_up) > remaining;
+        }
+
+        // Points the root to the statistics of its position, if shared.
+        static void
+        share_statistics_(tree &tree)
+        {
+                tree.root_stats = &tree.root_own;
+                if constexpr (hashable<Game>) {
+                        if (!tree.transpositions)
+                                return;
+                        const auto &game   = tree.game;
+                        auto       *shared = tree.transpositions->find(
+                            game.hash(), game.turn());
+                        if (shared)
+                                tree.root_stats = shared;
+                }
+        }
+
+        // Points the child to the statistics of its position, if shared;
+        // `game` being at that position.
+        static void
+        share_statistics_(tree &tree, location at, const Game &game)
+        {
+                if constexpr (hashable<Game>) {
+                        if (!tree.transpositions)
+                                return;
+                        at.parent->shared[at.slot] = tree.transpositions->find(
+                            game.hash(), game.turn());
+                }
+        }
+
+        static statistics_ref
+        statistics_(tree &tree, location at)
+        {
+                if (!at.parent)
+                        return { tree.root_stats->visits,
+                                 tree.root_stats->payoff };
+                auto &parent = *at.parent;
+                if (parent.shared && parent.shared[at.slot])
+                        return { parent.shared[at.slot]->visits,
+                                 parent.shared[at.slot]->payoff };
+                return { parent.visits[at.slot], parent.payoffs[at.slot] };
+        }
+
+        static std::unique_lock<std::shared_mutex>
+        exclusive_lock_(tree &tree)
+        {
+                using clock = std::chrono::steady_clock;
+                auto start  = clock::now();
+                tree.exclusive_waiters.fetch_add(1, std::memory_order_relaxed);
+                auto lock = std::unique_lock(tree.mutex);
+                tree.exclusive_waiters.fetch_sub(1, std::memory_order_relaxed);
+                auto wait = std::chrono::nanoseconds(clock::now() - start);
+                tree.probes[tree.probe_count - 1].add_shared(
+                    probe::exclusive_lock_wait, wait.count());
+                return lock;
         }
 
-        node &
-        select_(const tree &tree)
+        size_t
+        virtual_loss_() const
+        {
+                bool shared = hyperparameters_.tree_parallelization > 1;
+                return shared ? hyperparameters_.virtual_loss : 0;
+        }
+
+        void
+        add_virtual_loss_(tree &tree, location at)
+        {
+                // Seen from the player who reaches the node; see backpropagate_
+                if (auto loss = virtual_loss_()) {
+                        auto stats = statistics_(tree, at);
+                        stats.visits.fetch_add(loss, std::memory_order_relaxed);
+                        stats.payoff.fetch_sub(loss, std::memory_order_relaxed);
+                }
+        }
+
+        // Slot of the best rated (UCT) expanded child.
+        size_t
+        next_(tree &tree, location at, node &node)
+        {
+                constexpr auto relaxed = std::memory_order_relaxed;
+                auto expanded = node.expanded.load(std::memory_order_acquire);
+                assert(expanded > 0);
+                auto parent_visits = statistics_(tree, at).visits.load(relaxed);
+                auto exploration   = hyperparameters_.exploration;
+                if (!at.parent && focused_.load(relaxed))
+                        exploration *= hyperparameters_.ponder_exploration;
+                if (!node.shared) // packed statistics; vectorized
+                        return uct::select(node.payoffs,
+                                           node.visits,
+                                           expanded,
+                                           exploration,
+                                           parent_visits);
+
+                // Some may be shared; one child at a time.
+                auto log_parent_visits = std::log(float(parent_visits));
+                auto best              = size_t(0);
+                auto best_rate = -std::numeric_limits<float>::infinity();
+                for (size_t slot = 0; slot < expanded; ++slot) {
+                        auto stats = statistics_(tree, { &node, slot });
+                        auto rate  = uct::rate(stats.payoff.load(relaxed),
+                                              stats.visits.load(relaxed),
+                                              exploration,
+                                              log_parent_visits);
+                        if (rate > best_rate) {
+                                best      = slot;
+                                best_rate = rate;
+                        }
+                }
+                return best;
+        }
+
+        // Node of the child, created if need be; the scratch game being at
+        // its position. Null if terminal (no children) or out of node memory.
+        node *
+        child_node_(tree &tree, location at, scratch_space &scratch)
+        {
+                const auto &game = *scratch.game;
+                if (game.is_over())
+                        return nullptr;
+                auto &parent = *at.parent;
+                auto &child  = parent.children[at.slot];
+                if (auto *existing = child.load(std::memory_order_acquire))
+                        return existing;
+                auto lock = std::lock_guard(parent.mutex);
+                if (auto *existing = child.load(std::memory_order_relaxed))
+                        return existing; // created by another search thread
+                auto &memory  = tree.storage->magazines[scratch.index];
+                auto *created = make_node_(tree, at, game, memory);
+                if (created)
+                        child.store(created, std::memory_order_release);
+                else if (hyperparameters_.pruning > 0 && !tree.frozen)
+                        tree.memory_full.store(true, std::memory_order_relaxed);
+                return created;
+        }
+
+        // Moves the tree to fresh node memory, in which it is contiguous;
+        // leaving behind the freed nodes. Requires exclusive access.
+        // Keeps the tree as is if it does not fit.
+        void
+        compact_(tree &tree)
+        {
+                auto &old     = *tree.storage;
+                auto  storage = std::make_unique<node_storage>(
+                    old.arena.capacity(), old.magazines.size());
+                auto *root = relocate_(*tree.root, {}, *storage);
+                if (!root)
+                        return;
+                destroy_node_(old, tree.root, old.slabs);
+                tree.root    = root;
+                tree.storage = std::move(storage);
+        }
+
+        // Recycles node memory once full: prunes the least visited
+        // subtrees, sparing the principal variations, then compacts.
+        void
+        collect_garbage_(tree &tree)
         {
-                auto        *it        = tree.root.get();
+                auto lock = exclusive_lock_(tree);
+                if (!tree.memory_full.exchange(false,
+                                               std::memory_order_relaxed))
+                        return; // collected by another search thread
+                auto &storage = *tree.storage;
+                auto &root    = *tree.root;
+                auto  visits  = [&tree](node &parent, size_t slot) {
+                        return statistics_(tree, { &parent, slot })
+                            .visits.load(std::memory_order_relaxed);
+                };
+
+                // Spared nodes:
+                auto slots = std::vector<size_t>(root.expanded);
+                std::iota(slots.begin(), slots.end(), 0);
+                auto spared_count = std::min(
+                    slots.size(), hyperparameters_.spared_variations);
+                std::ranges::partial_sort(
+                    slots,
+                    slots.begin() + spared_count,
+                    std::ranges::greater{},
+                    [&](size_t slot) { return visits(root, slot); });
+                auto spared = std::vector<const node *>();
+                for (size_t i = 0; i < spared_count; ++i) {
+                        auto *it = root.children[slots[i]].load();
+                        while (it) {
+                                spared.push_back(it);
+                                auto next = std::span(it->children,
+                                                      it->expanded.load());
+                                if (next.empty())
+                                        break;
+                                auto best = std::ranges::max_element(
+                                    std::views::iota(size_t(0), next.size()),
+                                    std::ranges::less{},
+                                    [&](size_t slot) {
+                                            return visits(*it, slot);
+                                    });
+                                it = next[*best].load();
+                        }
+                }
+                std::ranges::sort(spared);
+
+                // Pruning threshold, from the visits of all the nodes:
+                auto counts = std::vector<visit_count>();
+                auto gather = [&](auto &self, node &parent) -> void {
+                        for (size_t slot = 0; slot < parent.expanded; ++slot) {
+                                auto *child = parent.children[slot].load();
+                                if (!child)
+                                        continue;
+                                counts.push_back(visits(parent, slot));
+                                self(self, *child);
+                        }
+                };
+                gather(gather, root);
+                if (counts.empty()) {
+                        tree.frozen = true;
+                        return;
+                }
+                auto nth = counts.begin()
+                           + std::min<size_t>(
+                               counts.size() * hyperparameters_.pruning,
+                               counts.size() - 1);
+                std::ranges::nth_element(counts, nth);
+                const auto threshold = *nth;
+                // Ties at the threshold (e.g. the many single visits) are
+                // only pruned up to the target count, not all of them:
+                auto ties = size_t(nth - counts.begin()) + 1
+                            - size_t(std::count_if(
+                                counts.begin(), nth, [&](visit_count count) {
+                                        return count < threshold;
+                                }));
+
+                // Prune:
+                size_t pruned = 0;
+                auto   prune  = [&](auto &self, node &parent) -> void {
+                        for (size_t slot = 0; slot < parent.expanded; ++slot) {
+                                auto *child = parent.children[slot].load();
+                                if (!child)
+                                        continue;
+                                auto count = visits(parent, slot);
+                                bool keep
+                                    = count > threshold
+                                      || (count == threshold && ties == 0)
+                                      || std::ranges::binary_search(spared,
+                                                                    child);
+                                if (keep) {
+                                        self(self, *child);
+                                        continue;
+                                }
+                                destroy_node_(storage, child, storage.slabs);
+                                parent.children[slot].store(nullptr);
+                                pruned++;
+                                if (count == threshold)
+                                        ties--;
+                        }
+                };
+                prune(prune, root);
+                if (pruned == 0) {
+                        tree.frozen = true; // nothing to recycle
+                        return;
+                }
+                compact_(tree);
+        }
+
+        struct selection {
+                location at;
+                node    *last;  // node at `at`, if any; to be expanded
+                size_t   depth; // of `at`
+        };
+
+        // Descends the tree, playing on the scratch game along the way.
+        selection
+        select_(tree &tree, scratch_space &scratch)
+        {
+                auto         at        = location{}; // root
+                auto        *it        = tree.root;  // node at `at`
                 size_t       depth     = 0;
                 const size_t max_depth = hyperparameters_.max_depth.value_or(
                     std::numeric_limits<size_t>::max());
 
-                while (depth + 1 < max_depth && !should_select_(*it)) {
-                        it = &next_(*it);
+                add_virtual_loss_(tree, at);
+                while (it && depth + 1 < max_depth && !should_select_(*it)) {
+                        at = { it, next_(tree, at, *it) };
+                        add_virtual_loss_(tree, at);
+                        play_(scratch, decode_(*scratch.game,
+                                               it->actions[at.slot]));
+                        it = child_node_(tree, at, scratch);
                         depth++;
                 }
-
-                return *it;
+                return { at, it, depth };
         }
 
         bool
         should_select_(const node &node)
         {
-                bool terminal   = node.game.is_over();
-                bool parent     = !node.children.empty();
-                bool expandable = !node.untried.empty();
-                assert(!(terminal && parent));
+                auto expanded   = node.expanded.load(std::memory_order_acquire);
+                bool terminal   = node.width == 0;
+                bool expandable = expanded < node.width;
                 return terminal || expandable;
         }
 
-        inline node &
-        next_(const node &node)
-        {
-                assert(!node.children.empty());
-                return *std::max_element(node.children.begin(),
-                                         node.children.end(),
-                                         [this](const auto &a, const auto &b) {
-                                                 return rate_(*a) < rate_(*b);
-                                         })
-                            ->get();
-        }
-
-        node &
-        expand_(node &parent)
+        std::optional<location> // none if not expandable (anymore)
+        expand_(tree &tree, node &parent, scratch_space &scratch)
         {
-                assert(not node_memory_.full());
-
-                static thread_local std::mt19937 rng{ std::random_device{}() };
+                auto lock     = std::lock_guard(parent.mutex);
+                auto expanded = parent.expanded.load(std::memory_order_relaxed);
+                if (expanded == parent.width) // by other search threads
+                        return std::nullopt;
 
                 // Pick random untried action:
-                assert(!parent.untried.empty());
-                std::uniform_int_distribution<size_t> distribution(
-                    0, parent.untried.size() - 1);
-                std::swap(parent.untried.back(),
-                          parent.untried[distribution(rng)]);
-                auto action = parent.untried.back();
-                parent.untried.pop_back();
+                auto pick = expanded
+                            + uniform_below(scratch.random,
+                                            parent.width - expanded);
+                std::swap(parent.actions[expanded], parent.actions[pick]);
+                auto child = location{ &parent, expanded };
+                play_(scratch,
+                      decode_(*scratch.game, parent.actions[child.slot]));
+                share_statistics_(tree, child, *scratch.game);
+
+                // Publish and return it:
+                parent.expanded.store(expanded + 1, std::memory_order_release);
+                add_virtual_loss_(tree, child);
+                return child;
+        }
 
-                // Allocate and return corresponding child node:
-                parent.children.emplace_back(make_node(parent, action));
-                return *parent.children.back();
+        static void
+        play_(scratch_space &scratch, const typename Game::action &action)
+        {
+                scratch.game->play(action);
+                scratch.played.push_back(action);
         }
 
-        inline Game
-        random_playout_(Game &&game)
+        // Plays randomly until the game is over, recording the plays.
+        // Returns the payoff seen from the player who reaches the starting
+        // position.
+        static float
+        rollout_(Game &game, std::vector<typename Game::action> &played,
+                 Random &random)
         {
-                static thread_local std::mt19937 rng(std::random_device{}());
+                const auto player = game.current_opponent();
                 while (!game.is_over()) {
-                        auto actions = game.playable_actions();
-                        assert(!actions.empty());
-                        std::uniform_int_distribution<size_t> distribution(
-                            0, actions.size() - 1);
-                        const auto &action = actions[distribution(rng)];
+                        auto action = game.random_playable_action(random);
                         game.play(action);
+                        played.push_back(action);
                 }
-                return game;
+                auto winner = game.winner();
+                return winner ? (winner == player ? 1 : -1) : 0;
         }
 
         float // delta-payoff from perspective of player who reaches node
-        simulate_(const node &node)
+        simulate_(tree &tree, scratch_space &scratch, probe *timing = nullptr)
         {
-                auto delta_payoff_ = [this, &node]() {
-                        auto player = node.game.current_opponent();
-                        auto winner = random_playout_(Game(node.game)).winner();
-                        return winner ? (winner == player ? 1 : -1) : 0;
-                };
+                // Scratch game is at the node's position; restored by caller.
+                auto &game = *scratch.game;
 
-                bool trivial = node.game.is_over(); // no actual simulation made
+                bool trivial = game.is_over(); // no actual simulation made
 
                 size_t parallelization = hyperparameters_.leaf_parallelization;
                 bool   concurrent      = parallelization > 1 && not trivial;
 
                 if (not concurrent)
-                        return delta_payoff_();
+                        return rollout_(game, scratch.played, scratch.random);
                 // else
 
-                // dispatch simulations to the worker pool:
-
-                std::vector<std::future<float> > results;
-                results.reserve(parallelization);
-
-                for (size_t i = 0; i < results.capacity(); ++i) {
-                        auto task = std::packaged_task<float()>(delta_payoff_);
-                        results.push_back(task.get_future());
-                        asio::execution::execute(
-                            asio::require(
-                                worker_pool_.get_executor(),
-                                asio::execution::outstanding_work.tracked),
-                            std::move(task));
+                // One batch, shared with the workers; they replay the path
+                // from the root, which the shared lock keeps unchanged.
+                auto at    = typename decltype(playouts_)::position{
+                           &tree.game, tree.root_version, scratch.played };
+                auto batch = playouts_.run(
+                    scratch.thread, at, game, parallelization, timing);
+                if (timing) {
+                        timing->add(probe::queued, batch.offloaded);
+                        timing->add(probe::queue_latency,
+                                    batch.queue_latency.count());
                 }
 
                 auto sum = std::accumulate(
-                    results.begin(), results.end(), 0.0f, [](auto a, auto &b) {
-                            return a + b.get();
-                    });
-
-                auto average = sum / results.size();
-                return average;
+                    batch.payoffs.begin(), batch.payoffs.end(), 0.0f);
+                return sum / batch.payoffs.size();
         }
 
         void
-        backpropagate_(node &node, float payoff)
+        backpropagate_(tree &tree, location leaf, float payoff)
         {
                 // payoff is seen from perspective of player who reaches node
 
-                for (auto *it = &node; it != nullptr; it = it->parent) {
-                        it->visits++;
-                        it->payoff += payoff;
+                // Reverts the virtual loss added while selecting the path.
+                // Note: unsigned wrap-around makes `1 - loss` well defined.
+                const auto loss = virtual_loss_();
+
+                for (auto at = leaf;;) {
+                        auto stats = statistics_(tree, at);
+                        stats.visits.fetch_add(1 - loss,
+                                               std::memory_order_relaxed);
+                        stats.payoff.fetch_add(payoff + loss,
+                                               std::memory_order_relaxed);
                         static_assert(Game::player_count() == 2);
                         payoff *= -1; // switch perspective
+                        if (!at.parent)
+                                break;
+                        at = { at.parent->parent, at.parent->slot };
                 }
         }
 
         void
-        iterate_(tree &tree)
-        {
-                std::lock_guard lock(tree.mutex);
-                auto            node = &select_(tree);
-                if (!node->untried.empty() && !node_memory_.full())
-                        node = &expand_(*node);
-                backpropagate_(*node, simulate_(*node));
-                iteration_count_.fetch_add(1, std::memory_order_relaxed);
+        iterate_(tree &tree, scratch_space &scratch)
+        {
+                // Phases are timed one iteration in timing_period; each lap
+                // adds the time since the previous one to a measure.
+                using clock     = std::chrono::steady_clock;
+                auto &counters  = tree.probes[scratch.index];
+                auto  period    = hyperparameters_.timing_period;
+                bool  timed     = period && scratch.iterations++ % period == 0;
+                auto  lap_start = timed ? clock::now() : clock::time_point();
+                auto  lap       = [&](typename probe::measure measure) {
+                        if (!timed)
+                                return;
+                        auto now  = clock::now();
+                        auto time = std::chrono::nanoseconds(now - lap_start);
+                        counters.add(measure, time.count());
+                        lap_start = now;
+                };
+
+                std::shared_lock lock(tree.mutex);
+                lap(probe::lock_wait);
+                if (scratch.root_version != tree.root_version) {
+                        scratch.game.emplace(tree.game);
+                        scratch.root_version = tree.root_version;
+                }
+                assert(scratch.played.empty());
+
+                auto [leaf, last, depth] = select_(tree, scratch);
+                lap(probe::select);
+                if (last)
+                        if (auto child = expand_(tree, *last, scratch)) {
+                                leaf = *child;
+                                depth++;
+                        }
+                lap(probe::expand);
+                auto payoff
+                    = simulate_(tree, scratch, timed ? &counters : nullptr);
+                lap(probe::simulate);
+                backpropagate_(tree, leaf, payoff);
+
+                // Back to the root position:
+                for (auto &played = scratch.played; !played.empty();
+                     played.pop_back())
+                        scratch.game->undo(played.back());
+                lap(probe::backpropagate);
+
+                tree.iteration_count.fetch_add(1, std::memory_order_relaxed);
+                counters.add(probe::iterations, 1);
+                counters.add(probe::depth, depth);
+                counters.add(probe::timed, timed);
+                auto &max_depth = counters.max_depth;
+                if (depth > max_depth.load(std::memory_order_relaxed))
+                        max_depth.store(depth, std::memory_order_relaxed);
         }
 };
 
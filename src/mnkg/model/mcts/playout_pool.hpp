@@ -0,0 +1,262 @@
+// Pool of persistent worker threads running batches of playouts, for leaf
+// parallelization.
+// Features:
+// - A batch holds all the playouts of a position. It is posted at once (one
+//   lock, one wake-up) and shared between the workers and the posting
+//   thread, which then waits for the rest (one barrier).
+// - Workers keep their own copies of the root positions, made once per root
+//   (i.e. per move). They reach a batch's position by playing the path to
+//   it, then undo it all.
+// - Payoffs are written into a fixed array per posting thread. Nothing is
+//   allocated per batch, and there are no futures.
+// - Several threads may post batches at once; workers serve them in order.
+// - Each thread has its own playout object (e.g. its own random generator).
+// Posting threads must keep the root position alive and unchanged until
+// their batch is done.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <concepts>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+namespace mnkg::model::mcts {
+
+// Playouts are called as float(Game &, std::vector<Game::action> &played):
+// they play the game out, push the actions played, and return the payoff.
+template <class Game, class Playout>
+class playout_pool {
+public:
+        using action = typename Game::action;
+
+        // Position of a batch: the path to it from a root position.
+        struct position {
+                const Game             *root;
+                size_t                  root_version; // changes with it
+                std::span<const action> path;
+        };
+
+        struct batch_result {
+                std::span<const float> payoffs;
+                size_t                 offloaded; // playouts run by workers
+                // Summed over offloaded playouts, if timed.
+                std::chrono::nanoseconds queue_latency;
+        };
+
+private:
+        using clock = std::chrono::steady_clock;
+
+        // Batch of a posting thread; reused by its next ones.
+        struct alignas(64) batch {
+                position                 at;
+                size_t                   size;
+                bool                     timed;
+                clock::time_point        posted_at;
+                std::unique_ptr<float[]> payoffs;
+                std::optional<Playout>   playout; // by the posting thread
+                std::vector<action>      played;
+
+                std::atomic<size_t>       next = 0; // playout to claim
+                std::atomic<size_t>       done = 0;
+                std::atomic<size_t>       offloaded     = 0;
+                std::atomic<std::int64_t> queue_latency = 0; // ns
+                bool pending = false; // in pending_; guarded by mutex_
+        };
+
+        // A worker's copy of a root position.
+        struct replica {
+                const Game          *root;
+                size_t               root_version;
+                std::optional<Game>  game;
+        };
+
+        size_t                      capacity_; // playouts per batch
+        std::unique_ptr<batch[]>    batches_;  // by posting thread
+        std::mutex                  mutex_;
+        std::condition_variable_any pending_changed_;
+        std::vector<batch *>        pending_; // with playouts to claim
+        std::vector<std::jthread>   workers_; // destroyed first
+
+        // Plays out from the game's position, then restores it.
+        static float
+        play_out_(Playout &playout, Game &game, std::vector<action> &played)
+        {
+                auto payoff = playout(game, played);
+                for (; !played.empty(); played.pop_back())
+                        game.undo(played.back());
+                return payoff;
+        }
+
+        void
+        work_(std::stop_token stop_token, Playout playout)
+        {
+                auto replicas = std::vector<replica>();
+                auto played   = std::vector<action>();
+
+                auto lock = std::unique_lock(mutex_);
+                while (pending_changed_.wait(lock, stop_token, [this] {
+                        return !pending_.empty();
+                })) {
+                        // Claimed under the lock, so that the batch is not
+                        // withdrawn meanwhile (see run).
+                        auto &batch = *pending_.front();
+                        auto  index = batch.next.fetch_add(
+                            1, std::memory_order_relaxed);
+                        if (index + 1 >= batch.size) {
+                                pending_.erase(pending_.begin());
+                                batch.pending = false;
+                        }
+                        if (index >= batch.size)
+                                continue;
+                        lock.unlock();
+                        run_(batch, index, playout, replicas, played);
+                        lock.lock();
+                }
+        }
+
+        void
+        run_(batch &batch, size_t index, Playout &playout,
+             std::vector<replica> &replicas, std::vector<action> &played)
+        {
+                constexpr auto relaxed = std::memory_order_relaxed;
+                if (batch.timed) {
+                        auto latency = std::chrono::nanoseconds(
+                            clock::now() - batch.posted_at);
+                        batch.queue_latency.fetch_add(latency.count(),
+                                                      relaxed);
+                }
+                batch.offloaded.fetch_add(1, relaxed);
+
+                auto &game = replica_(replicas, batch.at);
+                for (const auto &action : batch.at.path) {
+                        game.play(action);
+                        played.push_back(action);
+                }
+                batch.payoffs[index] = play_out_(playout, game, played);
+
+                // Last use of the batch, which may be reused as soon as it
+                // is done; but for the notification (batches outlive the
+                // workers).
+                auto size = batch.size;
+                auto done = batch.done.fetch_add(
+                                1, std::memory_order_release)
+                            + 1;
+                if (done == size)
+                        batch.done.notify_one();
+        }
+
+        // The worker's game at the root position; copied if outdated.
+        static Game &
+        replica_(std::vector<replica> &replicas, const position &at)
+        {
+                auto it = std::ranges::find(replicas, at.root, &replica::root);
+                if (it == replicas.end())
+                        it = replicas.insert(it, { at.root, 0, std::nullopt });
+                if (!it->game || it->root_version != at.root_version) {
+                        it->game.emplace(*at.root);
+                        it->root_version = at.root_version;
+                }
+                return *it->game;
+        }
+
+public:
+        // Batches of up to `capacity` playouts, posted by threads indexed
+        // below `poster_count`. Their playout objects are made by
+        // make_playout(index): posting threads first, then workers.
+        template <std::invocable<size_t> Factory>
+        playout_pool(size_t worker_count, size_t poster_count,
+                     size_t capacity, Factory make_playout) :
+                capacity_(capacity),
+                batches_(std::make_unique<batch[]>(poster_count))
+        {
+                assert(capacity > 0);
+                for (size_t i = 0; i < poster_count; ++i) {
+                        batches_[i].payoffs
+                            = std::make_unique<float[]>(capacity);
+                        batches_[i].playout.emplace(make_playout(i));
+                }
+                pending_.reserve(poster_count);
+                for (size_t i = 0; i < worker_count; ++i)
+                        workers_.emplace_back(
+                            [this](std::stop_token stop_token,
+                                   Playout         playout) {
+                                    work_(stop_token, std::move(playout));
+                            },
+                            make_playout(poster_count + i));
+        }
+        playout_pool(const playout_pool &) = delete;
+        playout_pool(playout_pool &&)      = delete;
+
+        // Runs `count` playouts from the position, `game` being the posting
+        // thread's own copy of it (restored). Blocks until they are done;
+        // the payoffs stay valid until the thread's next batch.
+        batch_result
+        run(size_t poster, const position &at, Game &game, size_t count,
+            bool timed = false)
+        {
+                assert(count > 0 && count <= capacity_);
+                constexpr auto relaxed = std::memory_order_relaxed;
+                auto          &batch   = batches_[poster];
+                batch.at               = at;
+                batch.size             = count;
+                batch.timed            = timed;
+                batch.posted_at = timed ? clock::now() : clock::time_point();
+                batch.next.store(0, relaxed);
+                batch.done.store(0, relaxed);
+                batch.offloaded.store(0, relaxed);
+                batch.queue_latency.store(0, relaxed);
+
+                // Fan out:
+                bool offload = count > 1 && !workers_.empty();
+                if (offload) {
+                        {
+                                auto lock     = std::lock_guard(mutex_);
+                                batch.pending = true;
+                                pending_.push_back(&batch);
+                        }
+                        pending_changed_.notify_all();
+                }
+
+                // Take part:
+                for (auto index = batch.next.fetch_add(1, relaxed);
+                     index < count;
+                     index = batch.next.fetch_add(1, relaxed)) {
+                        batch.payoffs[index] = play_out_(
+                            *batch.playout, game, batch.played);
+                        batch.done.fetch_add(1, relaxed);
+                }
+                if (offload) {
+                        // All claimed; withdraw it, unless done by a worker.
+                        auto lock = std::lock_guard(mutex_);
+                        if (batch.pending) {
+                                std::erase(pending_, &batch);
+                                batch.pending = false;
+                        }
+                }
+
+                // Barrier:
+                for (auto done = batch.done.load(std::memory_order_acquire);
+                     done < count;
+                     done = batch.done.load(std::memory_order_acquire))
+                        batch.done.wait(done, std::memory_order_acquire);
+
+                return { .payoffs = { batch.payoffs.get(), count },
+                         .offloaded     = batch.offloaded.load(relaxed),
+                         .queue_latency = std::chrono::nanoseconds(
+                             batch.queue_latency.load(relaxed)) };
+        }
+};
+
+} // namespace mnkg::model::mcts
@@ -0,0 +1,119 @@
+// Fixed-size hash table mapping position hashes to node statistics, so that
+// the MCTS nodes of transposed positions (same position, reached through
+// different move orders) share them.
+// Features:
+// - Lock-free: entries are claimed by compare-and-swap on their key.
+// - Open addressing with bounded linear probing. Lookups fail if all the
+//   probed entries are taken, or on reaching one being claimed (whose key
+//   is not known yet); callers then keep unshared statistics.
+// - Entries older than the horizon (i.e. positions no longer reachable from
+//   the search root) are recycled.
+// - No collision detection beyond the 64-bit hash itself.
+// Statistics must be default constructible and zero-initialized on it.
+
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace mnkg::model::mcts {
+
+template <typename Statistics>
+class transposition_table {
+public:
+        using key_type = std::uint64_t;
+
+private:
+        static constexpr key_type    empty    = 0;
+        static constexpr key_type    reserved = ~key_type(0); // (re)claiming
+        static constexpr std::size_t probes   = 8;
+
+        struct entry {
+                std::atomic<key_type>    key = empty;
+                std::atomic<std::size_t> age = 0; // e.g. turn of the position
+                Statistics               statistics;
+        };
+
+        std::unique_ptr<entry[]> entries_;
+        std::size_t              mask_;
+        std::atomic<std::size_t> horizon_ = 0;
+
+public:
+        explicit transposition_table(std::size_t size) :
+                entries_(std::make_unique<entry[]>(std::bit_ceil(size))),
+                mask_(std::bit_ceil(size) - 1)
+        {
+                assert(size > 0);
+        }
+
+        transposition_table(const transposition_table &) = delete;
+
+        std::size_t
+        size() const noexcept
+        {
+                return mask_ + 1;
+        }
+
+        // Entries aged below the horizon may be recycled.
+        void
+        set_horizon(std::size_t age) noexcept
+        {
+                horizon_.store(age, std::memory_order_relaxed);
+        }
+
+        // Statistics of the key, inserted if missing; null if out of room,
+        // or if an entry is being claimed (maybe for the same key: probing
+        // past it could claim that key twice, and waiting would block).
+        Statistics *
+        find(key_type hash, std::size_t age) noexcept
+        {
+                if (hash == empty || hash == reserved)
+                        hash = 1; // sentinel values; alias them
+                const auto horizon = horizon_.load(std::memory_order_relaxed);
+                for (std::size_t i = 0; i < probes; ++i) {
+                        auto &entry   = entries_[(hash + i) & mask_];
+                        auto  current
+                            = entry.key.load(std::memory_order_acquire);
+                        for (;;) {
+                                if (current == reserved)
+                                        return nullptr;
+                                if (current == hash)
+                                        return &entry.statistics;
+                                auto age_of_entry = entry.age.load(
+                                    std::memory_order_relaxed);
+                                bool stale = current != empty
+                                             && age_of_entry < horizon;
+                                if (current != empty && !stale)
+                                        break; // taken; probe the next one
+                                if (entry.key.compare_exchange_strong(
+                                        current,
+                                        reserved,
+                                        std::memory_order_acquire))
+                                        return claim_(entry, hash, age, stale);
+                        }
+                }
+                return nullptr;
+        }
+
+private:
+        static Statistics *
+        claim_(entry      &entry,
+               key_type    hash,
+               std::size_t age,
+               bool        stale) noexcept
+        {
+                if (stale) {
+                        std::destroy_at(&entry.statistics);
+                        std::construct_at(&entry.statistics);
+                }
+                entry.age.store(age, std::memory_order_relaxed);
+                entry.key.store(hash, std::memory_order_release);
+                return &entry.statistics;
+        }
+};
+
+} // namespace mnkg::model::mcts
@@ -0,0 +1,170 @@
+// Vectorized UCT (Upper Confidence Bound 1 applied to trees) selection.
+//
+// Rates all the children of a node in one pass over their packed statistics
+// and returns the best one; the parent's log term is computed once.
+// Uses AVX-512 or AVX2 when compiled for them (e.g. -march=native, as in
+// release builds), and a scalar loop otherwise or for the remainder.
+//
+// Statistics are read with plain (vector) loads, even if atomic: values may
+// be stale or torn across children, as with relaxed loads, which the search
+// tolerates anyway.
+
+#pragma once
+
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace mnkg::model::mcts::uct {
+
+// Rate of a child; unvisited children come first.
+inline float
+rate(float payoff, std::uint32_t visits, float exploration,
+     float log_parent_visits) noexcept
+{
+        if (visits == 0)
+                return std::numeric_limits<float>::infinity();
+        return payoff / visits
+               + exploration * std::sqrt(log_parent_visits / visits);
+}
+
+// Index of the best rated of `count` children; the first one on ties.
+// Visit counts must fit in 31 bits.
+inline std::size_t
+select(const float *payoffs, const std::uint32_t *visits, std::size_t count,
+       float exploration, std::uint32_t parent_visits) noexcept
+{
+        const float log_parent_visits = std::log(float(parent_visits));
+        std::size_t best              = 0;
+        float       best_rate         = -std::numeric_limits<float>::infinity();
+        std::size_t i                 = 0;
+
+#if defined(__AVX512F__)
+        constexpr std::size_t lanes = 16;
+        if (count >= lanes) {
+                const auto c        = _mm512_set1_ps(exploration);
+                const auto log_n    = _mm512_set1_ps(log_parent_visits);
+                const auto infinity = _mm512_set1_ps(
+                    std::numeric_limits<float>::infinity());
+                auto max_rates = _mm512_set1_ps(best_rate);
+                auto max_index = _mm512_setzero_si512();
+                auto index     = _mm512_setr_epi32(
+                    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+                for (; i + lanes <= count; i += lanes) {
+                        auto n = _mm512_loadu_si512(visits + i);
+                        auto w = _mm512_loadu_ps(payoffs + i);
+                        auto inverse
+                            = _mm512_div_ps(_mm512_set1_ps(1),
+                                            _mm512_cvtepi32_ps(n));
+                        auto rates = _mm512_fmadd_ps(
+                            c,
+                            _mm512_sqrt_ps(_mm512_mul_ps(log_n, inverse)),
+                            _mm512_mul_ps(w, inverse));
+                        auto unvisited = _mm512_cmpeq_epi32_mask(
+                            n, _mm512_setzero_si512());
+                        rates = _mm512_mask_mov_ps(rates, unvisited, infinity);
+                        auto better
+                            = _mm512_cmp_ps_mask(rates, max_rates, _CMP_GT_OQ);
+                        max_rates
+                            = _mm512_mask_mov_ps(max_rates, better, rates);
+                        max_index
+                            = _mm512_mask_mov_epi32(max_index, better, index);
+                        index = _mm512_add_epi32(index, _mm512_set1_epi32(16));
+                }
+                alignas(64) float         rates[lanes];
+                alignas(64) std::uint32_t indices[lanes];
+                _mm512_store_ps(rates, max_rates);
+                _mm512_store_si512(indices, max_index);
+                for (std::size_t lane = 0; lane < lanes; ++lane)
+                        if (rates[lane] > best_rate
+                            || (rates[lane] == best_rate
+                                && indices[lane] < best)) {
+                                best      = indices[lane];
+                                best_rate = rates[lane];
+                        }
+        }
+#elif defined(__AVX2__)
+        constexpr std::size_t lanes = 8;
+        if (count >= lanes) {
+                const auto c        = _mm256_set1_ps(exploration);
+                const auto log_n    = _mm256_set1_ps(log_parent_visits);
+                const auto infinity = _mm256_set1_ps(
+                    std::numeric_limits<float>::infinity());
+                auto max_rates = _mm256_set1_ps(best_rate);
+                auto max_index = _mm256_setzero_si256();
+                auto index     = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+                for (; i + lanes <= count; i += lanes) {
+                        auto n = _mm256_loadu_si256(
+                            reinterpret_cast<const __m256i *>(visits + i));
+                        auto w = _mm256_loadu_ps(payoffs + i);
+                        auto inverse
+                            = _mm256_div_ps(_mm256_set1_ps(1),
+                                            _mm256_cvtepi32_ps(n));
+                        auto rates = _mm256_add_ps(
+                            _mm256_mul_ps(w, inverse),
+                            _mm256_mul_ps(c,
+                                          _mm256_sqrt_ps(_mm256_mul_ps(
+                                              log_n, inverse))));
+                        auto unvisited = _mm256_castsi256_ps(
+                            _mm256_cmpeq_epi32(n, _mm256_setzero_si256()));
+                        rates = _mm256_blendv_ps(rates, infinity, unvisited);
+                        auto better
+                            = _mm256_cmp_ps(rates, max_rates, _CMP_GT_OQ);
+                        max_rates = _mm256_blendv_ps(max_rates, rates, better);
+                        max_index = _mm256_castps_si256(
+                            _mm256_blendv_ps(_mm256_castsi256_ps(max_index),
+                                             _mm256_castsi256_ps(index),
+                                             better));
+                        index = _mm256_add_epi32(index, _mm256_set1_epi32(8));
+                }
+                alignas(32) float         rates[lanes];
+                alignas(32) std::uint32_t indices[lanes];
+                _mm256_store_ps(rates, max_rates);
+                _mm256_store_si256(reinterpret_cast<__m256i *>(indices),
+                                   max_index);
+                for (std::size_t lane = 0; lane < lanes; ++lane)
+                        if (rates[lane] > best_rate
+                            || (rates[lane] == best_rate
+                                && indices[lane] < best)) {
+                                best      = indices[lane];
+                                best_rate = rates[lane];
+                        }
+        }
+#endif
+
+        for (; i < count; ++i) {
+                auto rate = uct::rate(
+                    payoffs[i], visits[i], exploration, log_parent_visits);
+                if (rate > best_rate) {
+                        best      = i;
+                        best_rate = rate;
+                }
+        }
+        return best;
+}
+
+// Overload for atomic statistics, as stored in the tree.
+inline std::size_t
+select(const std::atomic<float>         *payoffs,
+       const std::atomic<std::uint32_t> *visits, std::size_t count,
+       float exploration, std::uint32_t parent_visits) noexcept
+{
+        static_assert(sizeof(std::atomic<float>) == sizeof(float));
+        static_assert(sizeof(std::atomic<std::uint32_t>)
+                      == sizeof(std::uint32_t));
+        static_assert(std::atomic<float>::is_always_lock_free);
+        static_assert(std::atomic<std::uint32_t>::is_always_lock_free);
+        return select(reinterpret_cast<const float *>(payoffs),
+                      reinterpret_cast<const std::uint32_t *>(visits),
+                      count,
+                      exploration,
+                      parent_visits);
+}
+
+} // namespace mnkg::model::mcts::uct
@@ -1,11 +1,196 @@
+// Bitboard representation of an m,n,k-game board.
+//
+// Each player's stones are stored in a fixed-capacity bitset, so the board
+// lives inline: copying it is a plain memory copy, with no heap allocation.
+//
+// Cells are flattened in row-major order (as in grid.hpp), but each row is
+// followed by one padding bit that is always empty. Shifting a bitset by the
+// stride of a direction thus never wraps a line around the edge of a row,
+// which allows detecting lines with a handful of word-wide shift-and-ANDs.
+//
+// Dimensions are either dynamic (board) or fixed at compile time, as template
+// arguments (e.g. basic_board<7, 6>). Fixed boards size their bitsets to fit,
+// and their indexing, bounds and line shifts constant-fold.
+
 #pragma once
 
 #include "model/player.hpp"
 #include "varia/grid.hpp"
+
+#include <array>
+#include <bitset>
 #include <optional>
+#include <stdexcept>
+#include <type_traits>
 
 namespace mnkg::model::mnk {
 
-using board = grid<std::optional<player::index> >;
+// Dimension given at run time.
+inline constexpr int dynamic_size = -1;
+
+template <int M = dynamic_size, int N = dynamic_size>
+class basic_board {
+public:
+        using position = point<int, 2>;
+        using cell     = std::optional<player::index>;
+
+        static constexpr bool fixed_size
+            = M != dynamic_size && N != dynamic_size;
+        static_assert(fixed_size ? M > 0 && N > 0 : M == N);
+
+        // Bits per player, padding included; if dynamic, fits 19x19 gomoku
+        // (19 * 20).
+        static constexpr std::size_t capacity = fixed_size ? M * (N + 1) : 512;
+
+        using bits = std::bitset<capacity>;
+
+private:
+        struct fixed_dimensions {
+                static constexpr position    size   = { M, N };
+                static constexpr std::size_t stride = N + 1;
+        };
+        struct dynamic_dimensions {
+                position    size   = { 0, 0 };
+                std::size_t stride = 1; // row length, padding included
+        };
+        using dimensions = std::conditional_t<fixed_size, fixed_dimensions,
+                                              dynamic_dimensions>;
+
+        [[no_unique_address]] dimensions dims_;
+        std::array<bits, 2> stones_ = {}; // one bitset per player
+
+public:
+        basic_board() = default;
+
+        explicit basic_board(const position &size)
+        {
+                assert(size[0] >= 0 && size[1] >= 0);
+                if constexpr (fixed_size) {
+                        if (size != dims_.size)
+                                throw std::invalid_argument(
+                                    "board size differs from the fixed one");
+                } else {
+                        dims_ = { size, std::size_t(size[1]) + 1 };
+                        if (size[0] * dims_.stride > capacity)
+                                throw std::length_error(
+                                    "board exceeds capacity");
+                }
+        }
+
+        position
+        get_size() const noexcept
+        {
+                return dims_.size;
+        }
+
+        std::size_t
+        get_cell_count() const noexcept
+        {
+                return dims_.size[0] * dims_.size[1];
+        }
+
+        inline std::size_t
+        index(const position &coords) const noexcept
+        {
+                assert(within(*this, coords));
+                return coords[0] * dims_.stride + coords[1];
+        }
+
+        // Index offsets of the line directions (0, 1), (1, 0), (1, 1) and
+        // (1, -1); see the padding note at the top of the file.
+        inline std::array<std::size_t, 4>
+        line_shifts() const noexcept
+        {
+                const auto stride = dims_.stride;
+                return { 1, stride, stride + 1, stride - 1 };
+        }
+
+        inline position
+        position_at(std::size_t index) const noexcept
+        {
+                const auto stride = dims_.stride;
+                auto coords = position{ static_cast<int>(index / stride),
+                                        static_cast<int>(index % stride) };
+                assert(within(*this, coords));
+                return coords;
+        }
+
+        inline cell
+        operator[](const position &coords) const noexcept
+        {
+                auto i = index(coords);
+                for (player::index player = 0; player < stones_.size();
+                     ++player)
+                        if (stones_[player][i])
+                                return player;
+                return std::nullopt;
+        }
+
+        inline bool
+        is_empty(const position &coords) const noexcept
+        {
+                auto i = index(coords);
+                return !stones_[0][i] && !stones_[1][i];
+        }
+
+        inline void
+        place(const position &coords, player::index player) noexcept
+        {
+                assert(player < stones_.size());
+                assert(is_empty(coords));
+                stones_[player][index(coords)] = true;
+        }
+
+        inline void
+        remove(const position &coords, player::index player) noexcept
+        {
+                assert(player < stones_.size());
+                assert(stones_[player][index(coords)]);
+                stones_[player][index(coords)] = false;
+        }
+
+        inline const bits &
+        stones(player::index player) const noexcept
+        {
+                assert(player < stones_.size());
+                return stones_[player];
+        }
+
+        inline bits
+        occupied() const noexcept
+        {
+                return stones_[0] | stones_[1];
+        }
+
+        // Whether the player has `span` aligned stones in any direction.
+        // If not `overline`, the alignment must be exactly `span` long.
+        bool
+        has_line(player::index player, std::size_t span,
+                 bool overline) const noexcept
+        {
+                assert(span > 0);
+                const auto &stones = this->stones(player);
+                for (auto shift : line_shifts()) {
+                        // Bit i of `run` is set iff a line of at least
+                        // `length` stones starts at bit i.
+                        auto        run    = stones;
+                        std::size_t length = 1;
+                        while (length * 2 <= span && run.any()) {
+                                run &= run >> (length * shift);
+                                length *= 2;
+                        }
+                        if (length < span)
+                                run &= run >> ((span - length) * shift);
+                        if (!overline) // discard lines that extend further
+                                run &= ~(stones >> (span * shift))
+                                       & ~(stones << shift);
+                        if (run.any())
+                                return true;
+                }
+                return false;
+        }
+};
+
+using board = basic_board<>;
 
-}
+} // namespace mnkg::model::mnk
@@ -5,67 +5,141 @@
 #include "board.hpp"
 #include "play_filter.hpp"
 #include "result.hpp"
+#include "run_lengths.hpp"
+#include "zobrist.hpp"
 
+#include "varia/random.hpp"
+#include "varia/sparse_set.hpp"
+
+#include <cstdint>
 #include <memory>
 #include <optional>
+#include <random>
+#include <ranges>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <variant>
 #include <vector>
 
 namespace mnkg::model::mnk {
 
-class game : public model::game::combinatorial<action> {
+// Of any game, whether its dimensions are dynamic or fixed.
+struct settings {
+        static const size_t player_count = 2;
+        struct board {
+                point<int, 2> size = { 3, 3 };
+        } board;
+        struct rules {
+                size_t line_span = 3;    // aligned moves needed to win
+                bool   overline  = true; // allow extra moves to win
+                play_filter::any play_filter = {}; // none
+        } rules = {};
+};
+
+enum class preset {
+        tictactoe,
+        connect4,
+        gomoku,
+};
+
+template <preset Preset>
+constexpr settings
+configuration()
+{
+        if constexpr (Preset == preset::tictactoe) {
+                return {
+                        .board = { .size = { 3, 3 } },
+                        .rules = { .line_span = 3 },
+                };
+        } else if constexpr (Preset == preset::connect4) {
+                return {
+                        .board = { .size = { 7, 6 } },
+                        .rules = { .line_span   = 4,
+                                   .overline    = true,
+                                   .play_filter = play_filter::gravity() },
+                };
+        } else if constexpr (Preset == preset::gomoku) {
+                return {
+                        .board = { .size = { 19, 19 } },
+                        .rules = { .line_span = 5, .overline = false },
+                };
+        }
+}
+
+constexpr settings
+configuration(preset preset)
+{
+        switch (preset) {
+        case preset::tictactoe:
+                return configuration<preset::tictactoe>();
+        case preset::connect4:
+                return configuration<preset::connect4>();
+        case preset::gomoku:
+                return configuration<preset::gomoku>();
+        }
+        std::unreachable();
+}
+
+// Line span given at run time, by the rules.
+inline constexpr size_t dynamic_span = 0;
+
+// The m,n,k-game, on a board of dynamic or fixed dimensions (see board.hpp);
+// its line span may be fixed as well. Fixed, they are compile-time constants
+// throughout: board indexing, bitset widths, win detection. See game and
+// preset_game.
+template <class Board = mnk::board, size_t LineSpan = dynamic_span>
+class basic_game final : public model::game::combinatorial<action> {
 public:
-        struct settings {
-                static const size_t player_count = 2;
-                struct board {
-                        point<int, 2> size = { 3, 3 };
-                } board;
-                struct rules {
-                        size_t line_span = 3;    // aligned moves needed to win
-                        bool   overline  = true; // allow extra moves to win
-                        std::unique_ptr<play_filter::base> play_filter;
-                } rules = {};
-        };
+        using settings = mnk::settings;
+        using preset   = mnk::preset;
 
-        enum class preset {
-                tictactoe,
-                connect4,
-                gomoku,
-        };
+        // Zobrist keys and filters' cell sets fit dynamic boards.
+        static_assert(Board::capacity <= board::capacity);
 
 public:
-        game(settings &&settings) :
+        basic_game(settings &&settings) :
                 board_(settings.board.size), rules_(std::move(settings.rules))
         {
+                if (LineSpan != dynamic_span && rules_.line_span != LineSpan)
+                        throw std::invalid_argument(
+                            "line span differs from the fixed one");
+                for (const auto &pos : coords(board_))
+                        empty_cells_.insert(board_.index(pos));
+                std::visit([this](auto &filter) { filter.reset(*this); },
+                           rules_.play_filter);
         }
 
-        game(const game &other) :
+        basic_game(const basic_game &other) :
                 combinatorial(other), board_(other.board_),
+                empty_cells_(other.empty_cells_), runs_(other.runs_),
+                hash_(other.hash_),
                 result_(other.result_),
-                rules_({ .line_span   = other.rules_.line_span,
-                         .overline    = other.rules_.overline,
-                         .play_filter = other.rules_.play_filter
-                                            ? other.rules_.play_filter->clone()
-                                            : nullptr })
+                rules_(other.rules_) // filter state included
         {
         }
 
-        virtual std::unique_ptr<game::combinatorial>
+        virtual std::unique_ptr<basic_game::combinatorial>
         clone() const override
         {
-                return std::make_unique<game>(*this);
+                return std::make_unique<basic_game>(*this);
         }
 
         friend void
-        swap(game &lhs, game &rhs)
+        swap(basic_game &lhs, basic_game &rhs)
         {
                 swap(static_cast<combinatorial &>(lhs),
                      static_cast<combinatorial &>(rhs));
                 std::swap(lhs.board_, rhs.board_);
+                std::swap(lhs.empty_cells_, rhs.empty_cells_);
+                std::swap(lhs.runs_, rhs.runs_);
+                std::swap(lhs.hash_, rhs.hash_);
                 std::swap(lhs.result_, rhs.result_);
+                std::swap(lhs.rules_, rhs.rules_); // filters follow boards
         }
 
-        game &
-        operator=(game other)
+        basic_game &
+        operator=(basic_game other)
         {
                 swap(*this, other);
                 return *this;
@@ -77,12 +151,19 @@ public:
                 return rules_;
         }
 
-        inline const board &
+        inline const Board &
         board() const noexcept
         {
                 return board_;
         }
 
+        // Zobrist hash of the board position.
+        zobrist::hash
+        hash() const noexcept
+        {
+                return hash_;
+        }
+
         const result &
         result() const noexcept
         {
@@ -90,24 +171,152 @@ public:
                 return result_.value();
         }
 
+        // Compact encoding of actions: their board index.
+        std::uint16_t
+        action_index(const action &position) const noexcept
+        {
+                return board_.index(position);
+        }
+
+        action
+        action_at(std::uint16_t index) const noexcept
+        {
+                return board_.position_at(index);
+        }
+
+        // Non-allocating alternative to playable_actions().
+        // Lazily evaluated; factual until next play.
+        auto
+        playable_actions_view() const
+        {
+                const auto *listed = allowed_cells_();
+                auto cells = listed ? listed->span() : empty_cells_.span();
+                if (is_over_())
+                        cells = cells.first(0);
+                auto position = [this](auto index) {
+                        return board_.position_at(index);
+                };
+                auto allowed = [this, listed](const action &action) {
+                        return listed || allowed_(action);
+                };
+                using namespace std::views;
+                return cells | transform(position) | filter(allowed);
+        }
+
+        // Shadows combinatorial::random_playable_action; O(1) if unfiltered,
+        // or if the filter lists the allowed cells.
+        template <std::uniform_random_bit_generator Generator>
+        action
+        random_playable_action(Generator &generator) const
+        {
+                assert(!is_over_());
+                auto pick = [&generator](std::size_t count) {
+                        return std::size_t(uniform_below(generator, count));
+                };
+                auto position = [this](auto index) {
+                        return board_.position_at(index);
+                };
+
+                const auto &cells = empty_cells_;
+                if (unfiltered_())
+                        return position(cells[pick(cells.size())]);
+                if (const auto *listed = allowed_cells_())
+                        return position((*listed)[pick(listed->size())]);
+                // Rejection sampling is O(1) if most empty cells are allowed.
+                constexpr auto attempts = 8;
+                for (auto attempt = 0; attempt < attempts; ++attempt) {
+                        auto action = position(cells[pick(cells.size())]);
+                        if (allowed_(action))
+                                return action;
+                }
+                // Otherwise, fall back to an exact two-pass selection.
+                auto actions = playable_actions_view();
+                auto count   = std::ranges::distance(actions);
+                return *std::ranges::next(actions.begin(), pick(count));
+        }
+
         class builder;
 
 private:
-        mnk::board                 board_;
-        std::optional<mnk::result> result_ = std::nullopt;
-        struct settings::rules     rules_;
+        friend class model::game::combinatorial<action>; // static dispatch
+
+        Board                         board_;
+        sparse_set<Board::capacity>   empty_cells_; // by board index
+        basic_run_lengths<Board>      runs_;
+        zobrist::hash                 hash_   = 0;
+        std::optional<mnk::result>    result_ = std::nullopt;
+        struct settings::rules        rules_;
+
+        size_t
+        line_span_() const noexcept
+        {
+                if constexpr (LineSpan != dynamic_span)
+                        return LineSpan;
+                else
+                        return rules_.line_span;
+        }
+
+        template <class Visitor>
+        decltype(auto)
+        visit_filter_(Visitor &&visitor)
+        {
+                return std::visit(std::forward<Visitor>(visitor),
+                                  rules_.play_filter);
+        }
+
+        template <class Visitor>
+        decltype(auto)
+        visit_filter_(Visitor &&visitor) const
+        {
+                return std::visit(std::forward<Visitor>(visitor),
+                                  rules_.play_filter);
+        }
+
+        bool
+        unfiltered_() const
+        {
+                return std::holds_alternative<play_filter::bypass>(
+                    rules_.play_filter);
+        }
+
+        // Whether the filter allows the (empty) cell.
+        bool
+        allowed_(const action &position) const
+        {
+                return visit_filter_([&](const auto &filter) {
+                        return filter.allowed(
+                            *this, current_player(), position);
+                });
+        }
+
+        const play_filter::cell_set *
+        allowed_cells_() const
+        {
+                return visit_filter_([](const auto &filter) {
+                        return filter.allowed_cells();
+                });
+        }
 
         virtual std::vector<action>
         playable_actions_() const override
         {
-                auto playable_actions = std::vector<action>();
                 if (is_over_())
-                        return playable_actions;
-                for (const auto &pos : coords(board())) {
-                        if (is_playable_(pos))
-                                playable_actions.push_back(pos);
-                }
-                return playable_actions;
+                        return {};
+                // Candidates, filtered in bulk.
+                const auto *listed = allowed_cells_();
+                auto cells   = listed ? listed->span() : empty_cells_.span();
+                auto actions = std::vector<action>();
+                actions.reserve(cells.size());
+                for (auto index : cells)
+                        actions.push_back(board_.position_at(index));
+                if (listed)
+                        return actions;
+                auto allowed = visit_filter_([&](const auto &filter) {
+                        return filter.filter_actions(
+                            *this, current_player(), actions);
+                });
+                actions.resize(allowed.size());
+                return actions;
         };
 
         virtual bool
@@ -116,12 +325,9 @@ private:
                 if (is_over_())
                         return false;
 
-                const auto &board  = this->board();
-                const auto &filter = rules().play_filter;
-                const auto &player = current_player();
-
-                return within(board, position) && !board[position].has_value()
-                       && (!filter || filter->allowed(*this, player, position));
+                const auto &board = this->board();
+                return within(board, position) && board.is_empty(position)
+                       && allowed_(position);
         }
 
         virtual std::optional<player::index>
@@ -136,53 +342,93 @@ private:
         play_(const action &position) override
         {
                 const auto &player = current_player();
-                board_[position]   = player;
-                for (auto line : find_lines(board_, position)) {
-                        auto len = length<metric::chebyshev>(line) + 1;
-                        if (rules_.overline ? len >= rules_.line_span
-                                            : len == rules_.line_span) {
-                                result_ = { win{ player, line } };
-                                return;
+                const auto  index  = board_.index(position);
+                board_.place(position, player);
+                empty_cells_.erase(index);
+                hash_ ^= zobrist::key(player, index);
+                visit_filter_([&](auto &filter) {
+                        filter.on_play(*this, position);
+                });
+                const auto  span     = line_span_();
+                const auto &overline = rules_.overline;
+                for (const auto &run : runs_.place(board_, index, player)) {
+                        auto len = run.length;
+                        if (overline ? len >= span : len == span) {
+                                auto first = board_.position_at(run.first);
+                                auto last  = board_.position_at(run.last);
+                                result_    = { win{ player, { first, last } } };
+                                break;
                         }
                 }
-                if ((turn() + 1) == board_.get_cell_count() && !result_)
+                assert(is_over_() == board_.has_line(player, span, overline));
+                if (!result_ && empty_cells_.empty())
                         result_ = { tie{} };
                 // turn_++; // incremented in combinatorial::play
         }
 
+        virtual void
+        undo_(const action &position) override
+        {
+                const auto &player = current_player(); // who played it
+                const auto  index  = board_.index(position);
+                runs_.remove(board_, index, player);
+                board_.remove(position, player);
+                empty_cells_.insert(index);
+                hash_ ^= zobrist::key(player, index);
+                visit_filter_([&](auto &filter) {
+                        filter.on_undo(*this, position);
+                });
+                result_ = std::nullopt; // as it was not over before playing
+        }
+
         virtual bool
         is_over_() const override
         {
                 return result_.has_value();
         }
-
-public:
-        template <preset Preset>
-        static game::settings
-        configuration()
-        {
-                if constexpr (Preset == preset::tictactoe) {
-                        return {
-                                .board = { .size = { 3, 3 } },
-                                .rules = { .line_span = 3 },
-                        };
-                } else if constexpr (Preset == preset::connect4) {
-                        return {
-                                .board = { .size = { 7, 6 } },
-                                .rules = { .line_span   = 4,
-                                           .overline    = true,
-                                           .play_filter = std::make_unique<
-                                               play_filter::gravity>() },
-                        };
-                } else if constexpr (Preset == preset::gomoku) {
-                        return {
-                                .board = { .size = { 19, 19 } },
-                                .rules = { .line_span = 5, .overline = false },
-                        };
-                }
-        }
 };
 
+using game = basic_game<>;
+
+// Whether the settings have the dimensions and line span of the preset.
+template <preset Preset>
+constexpr bool
+has_preset_dimensions(const settings &settings)
+{
+        constexpr auto preset = configuration<Preset>();
+        return settings.board.size == preset.board.size
+               && settings.rules.line_span == preset.rules.line_span;
+}
+
+// Game with the dimensions and line span of the preset fixed at compile time;
+// its rules are still those of the settings it is made of.
+template <preset Preset>
+using preset_game
+    = basic_game<basic_board<configuration<Preset>().board.size[0],
+                             configuration<Preset>().board.size[1]>,
+                 configuration<Preset>().rules.line_span>;
+
+// Calls visit(std::type_identity<Game>()) with the type of game to make of
+// the settings: the preset_game of their dimensions and line span if any;
+// game otherwise.
+template <class Visitor>
+decltype(auto)
+visit_game_type(const settings &settings, Visitor &&visit)
+{
+        using enum preset;
+        if (has_preset_dimensions<tictactoe>(settings))
+                return visit(std::type_identity<preset_game<tictactoe> >());
+        if (has_preset_dimensions<connect4>(settings))
+                return visit(std::type_identity<preset_game<connect4> >());
+        if (has_preset_dimensions<gomoku>(settings))
+                return visit(std::type_identity<preset_game<gomoku> >());
+        return visit(std::type_identity<game>());
+}
+
+static_assert(play_filter::filter<play_filter::bypass, game>
+              && play_filter::filter<play_filter::gravity, game>
+              && play_filter::filter<play_filter::proximity, game>);
+
 } // namespace mnkg::model::mnk
 
 namespace mnkg::model::game {
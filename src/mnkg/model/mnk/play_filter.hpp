@@ -1,99 +1,281 @@
+// Play filters: rules restricting where stones may be played, on top of the
+// board being empty there (e.g. gravity, as in Connect Four).
+// Filters are value types, held by the game in a variant (play_filter::any):
+// copying a game copies its filter inline, with no heap allocation, and
+// calls to filters are statically dispatched.
+// Filters may keep incremental state (e.g. which cells they allow), which
+// the game keeps in sync with its board through their hooks; see filter.
+// They work on any mnk game, whether its board size is dynamic or fixed.
+
 #pragma once
 #include "action.hpp"
+#include "board.hpp"
 #include "model/player.hpp"
-#include <memory>
-
-namespace mnkg::model::mnk {
+#include "varia/sparse_set.hpp"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <concepts>
+#include <cstdint>
+#include <span>
+#include <variant>
 
-class game; // forward declaration
+namespace mnkg::model::mnk::play_filter {
 
-namespace play_filter {
+// Board indices of cells; of any board up to the dynamic capacity.
+using cell_set = sparse_set<board::capacity>;
 
+// Defaults of the filter interface, for stateless filters; derived from as
+// base<Filter>.
+template <class Filter>
 class base {
-private:
-        virtual bool
-        allowed_(const game &game, const player::index &player,
-                 const action &action)
-            = 0;
-
 public:
-        bool
-        allowed(const game &game, const player::index &player,
-                const action &action)
+        // Hooks keeping the state of filters, if any, in sync with the
+        // board: called by the game on construction, and after each play
+        // and undo.
+        void
+        reset(const auto &game)
+        {
+        }
+
+        void
+        on_play(const auto &game, const action &action)
         {
-                return allowed_(game, player, action);
         }
 
-        virtual std::unique_ptr<base>
-        clone() const = 0;
+        void
+        on_undo(const auto &game, const action &action)
+        {
+        }
 
-        virtual ~base() = default;
+        // All the allowed cells, for filters keeping track of them; so that
+        // the game need not query each empty cell. Null otherwise.
+        const cell_set *
+        allowed_cells() const
+        {
+                return nullptr;
+        }
+
+        // Moves the allowed actions to the front, in order; returns them.
+        std::span<action>
+        filter_actions(const auto &game, const player::index &player,
+                       std::span<action> actions) const
+        {
+                const auto &self     = static_cast<const Filter &>(*this);
+                auto        rejected = std::ranges::remove_if(
+                    actions, [&](const action &action) {
+                            return !self.allowed(game, player, action);
+                    });
+                return actions.first(actions.size() - rejected.size());
+        }
 };
 
-class bypass : public play_filter::base {
-private:
+class bypass : public play_filter::base<bypass> {
+public:
         bool
-        allowed_(const game &game, const player::index &player,
-                 const action &action) override
+        allowed(const auto &game, const player::index &player,
+                const action &action) const
         {
                 return true;
         }
 
-public:
-        bypass()                    = default;
-        bypass(const bypass &other) = default;
-        virtual std::unique_ptr<base>
-        clone() const override
+        std::span<action>
+        filter_actions(const auto &game, const player::index &player,
+                       std::span<action> actions) const
         {
-                return std::make_unique<bypass>(*this);
-        };
+                return actions;
+        }
 };
 
 // Filters out actions that don't "fall in a straight line"
 // Intended for games like Connect Four
-class gravity : public play_filter::base {
+// Stones fall along lines in the given direction (e.g. columns), so that each
+// line that is not full allows one cell: the last empty one. These are kept
+// track of, in O(1) per play; so are queries.
+class gravity : public play_filter::base<gravity> {
 public:
-        gravity(board::position direction = { 0, 1 }) : direction_(direction)
+        constexpr gravity(board::position direction = { 0, 1 }) :
+                direction_(direction)
         {
                 assert(norm<metric::chebyshev>(direction) == 1);
         }
 
-        gravity(const gravity &other) = default;
+        bool
+        allowed(const auto &game, const player::index &player,
+                const action &action) const
+        {
+                return cells_.contains(game.board().index(action));
+        }
+
+        void
+        reset(const auto &game)
+        {
+                // Empty cells resting on a stone, or on the edge of the board.
+                const auto &board = game.board();
+                cells_.clear();
+                for (const auto &pos : coords(board)) {
+                        auto below = pos + direction_;
+                        if (board.is_empty(pos)
+                            && (!within(board, below)
+                                || !board.is_empty(below)))
+                                cells_.insert(board.index(pos));
+                }
+        }
+
+        void
+        on_play(const auto &game, const action &action)
+        {
+                // The cell above, if any, is next in its line.
+                const auto &board = game.board();
+                const auto  above = action - direction_;
+                cells_.erase(board.index(action));
+                if (within(board, above) && board.is_empty(above))
+                        cells_.insert(board.index(above));
+        }
+
+        void
+        on_undo(const auto &game, const action &action)
+        {
+                const auto &board = game.board();
+                const auto  above = action - direction_;
+                if (within(board, above)
+                    && cells_.contains(board.index(above)))
+                        cells_.erase(board.index(above));
+                cells_.insert(board.index(action));
+        }
 
-        virtual std::unique_ptr<base>
-        clone() const override
+        const cell_set *
+        allowed_cells() const
         {
-                return std::make_unique<gravity>(*this);
-        };
+                return &cells_;
+        }
 
 private:
         board::position direction_;
-
-        bool
-        allowed_(const game &game, const player::index &player,
-                 const action &action) override;
+        cell_set        cells_; // allowed: one per line that is not full
 };
 
 // Filters out actions that are not close to previous actions
-class proximity : public play_filter::base {
+// Allows the empty cells within range (Chebyshev distance, so diagonals
+// included) of a stone; or any cell, on an empty board. These cells, the
+// "frontier", are kept track of along with how many stones are within range
+// of each cell: in O(range^2) per play, and O(1) per query.
+// Intended for large boards (e.g. gomoku), to cut the branching factor.
+class proximity : public play_filter::base<proximity> {
 public:
-        proximity(size_t range = 1) : range_(range) {}
+        constexpr proximity(size_t range = 1) : range_(range)
+        {
+                assert(range > 0);
+        }
 
-        proximity(const proximity &other) = default;
+        bool
+        allowed(const auto &game, const player::index &player,
+                const action &action) const
+        {
+                return !stones_
+                       || frontier_.contains(game.board().index(action));
+        }
 
-        virtual std::unique_ptr<base>
-        clone() const override
+        void
+        reset(const auto &game)
         {
-                return std::make_unique<proximity>(*this);
-        };
+                const auto &board = game.board();
+                nearby_.fill(0);
+                frontier_.clear();
+                stones_ = 0;
+                for (const auto &pos : coords(board))
+                        if (!board.is_empty(pos)) {
+                                stones_++;
+                                for_each_nearby_(
+                                    board, pos, [this](auto index, auto) {
+                                            nearby_[index]++;
+                                    });
+                        }
+                for (const auto &pos : coords(board))
+                        if (board.is_empty(pos) && nearby_[board.index(pos)])
+                                frontier_.insert(board.index(pos));
+        }
+
+        void
+        on_play(const auto &game, const action &action)
+        {
+                const auto &board = game.board();
+                if (auto index = board.index(action); frontier_.contains(index))
+                        frontier_.erase(index);
+                stones_++;
+                for_each_nearby_(
+                    board, action, [this, &board](auto index, auto pos) {
+                            if (nearby_[index]++ == 0 && board.is_empty(pos))
+                                    frontier_.insert(index);
+                    });
+        }
+
+        void
+        on_undo(const auto &game, const action &action)
+        {
+                const auto &board = game.board();
+                stones_--;
+                for_each_nearby_(board, action, [this](auto index, auto) {
+                        if (--nearby_[index] == 0 && frontier_.contains(index))
+                                frontier_.erase(index);
+                });
+                if (auto index = board.index(action); nearby_[index])
+                        frontier_.insert(index);
+        }
+
+        const cell_set *
+        allowed_cells() const
+        {
+                return stones_ ? &frontier_ : nullptr;
+        }
 
 private:
-        size_t range_;
+        int      range_;
+        cell_set frontier_; // allowed, unless there are no stones
+        size_t   stones_ = 0;
+        std::array<std::uint16_t, board::capacity> nearby_ = {}; // stones
 
-        bool
-        allowed_(const game &game, const player::index &player,
-                 const action &action) override;
+        // Calls visit(index, position) on each cell within range of the
+        // position (itself included).
+        template <class Board, class Visitor>
+        void
+        for_each_nearby_(const Board &board, const action &pos,
+                         Visitor &&visit) const
+        {
+                const auto size = board.get_size();
+                const auto x0   = std::max(pos[0] - range_, 0);
+                const auto y0   = std::max(pos[1] - range_, 0);
+                const auto x1   = std::min(pos[0] + range_, size[0] - 1);
+                const auto y1   = std::min(pos[1] + range_, size[1] - 1);
+                for (auto x = x0; x <= x1; ++x)
+                        for (auto y = y0; y <= y1; ++y) {
+                                auto nearby = action{ x, y };
+                                visit(board.index(nearby), nearby);
+                        }
+        }
 };
 
-} // namespace play_filter
-} // namespace mnkg::model::mnk
+// Interface of the filters, on a game.
+template <class Filter, class Game>
+concept filter = std::copyable<Filter>
+                 && requires(Filter &self, const Filter &view,
+                             const Game &game, const player::index &player,
+                             std::span<action> actions, const action &action) {
+                            {
+                                    view.allowed(game, player, action)
+                            } -> std::same_as<bool>;
+                            {
+                                    view.filter_actions(game, player, actions)
+                            } -> std::same_as<std::span<mnk::action> >;
+                            {
+                                    view.allowed_cells()
+                            } -> std::same_as<const cell_set *>;
+                            self.reset(game);
+                            self.on_play(game, action);
+                            self.on_undo(game, action);
+                    };
+
+// Any of the filters; bypass (none) by default.
+using any = std::variant<bypass, gravity, proximity>;
+
+} // namespace mnkg::model::mnk::play_filter
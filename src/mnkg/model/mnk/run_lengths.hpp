@@ -0,0 +1,103 @@
+// Incremental tracking of runs of aligned stones, for O(1) win detection.
+//
+// For each line direction, the length of every run (maximal sequence of
+// aligned stones of one player) is stored at both of its ends. A placed
+// stone merges with the, at most two, adjacent runs; so only the ends of the
+// merged run need updating: O(1) per direction.
+// Lengths stored elsewhere than at run ends are stale and meaningless.
+// Removing a stone splits its runs; it walks them to find their new ends.
+//
+// Cells are addressed by board index, whose padding keeps runs from wrapping
+// around row edges; see board.hpp.
+
+#pragma once
+
+#include "board.hpp"
+#include "model/player.hpp"
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+namespace mnkg::model::mnk {
+
+template <class Board>
+class basic_run_lengths {
+public:
+        struct run {
+                std::size_t first, last; // board indices of its ends
+                std::size_t length;
+        };
+
+private:
+        // Per direction, as in board::line_shifts; by board index.
+        std::array<std::array<std::uint16_t, Board::capacity>, 4> lengths_
+            = {};
+
+public:
+        // Records a stone just placed on the board.
+        // Returns the runs, one per direction, the stone is now part of.
+        std::array<run, 4>
+        place(const Board &board, std::size_t index, player::index player)
+        {
+                const auto &stones = board.stones(player);
+                assert(stones[index]);
+                auto is_stone = [&stones](std::size_t i) {
+                        return i < Board::capacity && stones[i];
+                };
+                auto runs   = std::array<run, 4>();
+                auto shifts = board.line_shifts();
+                for (std::size_t dir = 0; dir < shifts.size(); ++dir) {
+                        auto &lengths = lengths_[dir];
+                        auto  shift   = shifts[dir];
+                        // Neighbours; unsigned wrap-around sends "negative"
+                        // ones past the capacity, thus off the board.
+                        std::size_t before = index - shift;
+                        std::size_t after  = index + shift;
+                        std::size_t lower  = 0, upper = 0;
+                        if (is_stone(before))
+                                lower = lengths[before];
+                        if (is_stone(after))
+                                upper = lengths[after];
+                        std::size_t length = lower + upper + 1;
+                        std::size_t first  = index - lower * shift;
+                        std::size_t last   = index + upper * shift;
+                        lengths[first] = lengths[last] = length;
+                        runs[dir]      = { first, last, length };
+                }
+                return runs;
+        }
+
+        // Records a stone about to be removed from the board.
+        void
+        remove(const Board &board, std::size_t index, player::index player)
+        {
+                const auto &stones = board.stones(player);
+                assert(stones[index]);
+                auto is_stone = [&stones](std::size_t i) {
+                        return i < Board::capacity && stones[i];
+                };
+                auto shifts = board.line_shifts();
+                for (std::size_t dir = 0; dir < shifts.size(); ++dir) {
+                        auto &lengths = lengths_[dir];
+                        auto  shift   = shifts[dir];
+                        // Split into the runs just before and after it:
+                        std::size_t lower = 0, upper = 0;
+                        while (is_stone(index - (lower + 1) * shift))
+                                lower++;
+                        while (is_stone(index + (upper + 1) * shift))
+                                upper++;
+                        if (lower > 0)
+                                lengths[index - shift]
+                                    = lengths[index - lower * shift] = lower;
+                        if (upper > 0)
+                                lengths[index + shift]
+                                    = lengths[index + upper * shift] = upper;
+                }
+        }
+};
+
+using run_lengths = basic_run_lengths<board>;
+
+} // namespace mnkg::model::mnk
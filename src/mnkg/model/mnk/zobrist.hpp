@@ -0,0 +1,39 @@
+// Zobrist hashing of board positions.
+// A position's hash is the XOR of one pseudo-random key per stone (player and
+// cell), so it is updated in O(1) per play; and undone by the very same XOR.
+// Keys are generated at compile time (SplitMix64), hence stable across runs.
+
+#pragma once
+
+#include "board.hpp"
+#include "model/player.hpp"
+
+#include <array>
+#include <cstdint>
+
+namespace mnkg::model::mnk::zobrist {
+
+using hash = std::uint64_t;
+
+inline constexpr auto keys = [] {
+        std::array<std::array<hash, board::capacity>, 2> keys  = {};
+        hash                                             state = 0;
+        for (auto &player_keys : keys)
+                for (auto &key : player_keys) {
+                        state += 0x9E3779B97F4A7C15;
+                        auto z = state;
+                        z      = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+                        z      = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+                        key    = z ^ (z >> 31);
+                }
+        return keys;
+}();
+
+// Key of a stone; `index` as given by board::index.
+inline constexpr hash
+key(player::index player, std::size_t index) noexcept
+{
+        return keys[player][index];
+}
+
+} // namespace mnkg::model::mnk::zobrist
@@ -0,0 +1,228 @@
+// Implementation of a simple, thread-safe arena memory resource.
+// Similar to std::pmr::monotonic_buffer_resource, but thread-safe.
+// Features:
+// - Fixed capacity, reserved as virtual memory (no upstream resource).
+// - Lazy: pages are only committed once touched, so startup is immediate
+//   and the resident size tracks the memory actually handed out.
+// - Optionally backed by huge pages (fewer TLB misses), where supported.
+// - Bump-pointer allocation: a single compare-and-swap, usually.
+// - No deallocation; memory is released with the arena.
+// Meant as the upstream resource of the slab memories.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <new>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#elif defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+namespace mnkg {
+
+class arena_memory : public std::pmr::memory_resource {
+public:
+        enum class pages {
+                normal,
+                transparent_huge, // advised, if supported (e.g. Linux THP)
+                explicit_huge,    // reserved ones, falling back to the above
+        };
+
+        static constexpr std::size_t huge_page_size = 2 << 20; // 2MiB
+
+private:
+        void       *mapping_      = nullptr; // as reserved
+        std::size_t mapping_size_ = 0;
+
+        std::byte               *buffer_; // huge page aligned within mapping_
+        std::size_t              capacity_;
+        std::atomic<std::size_t> used_ = 0;
+#if !defined(__unix__) && !defined(__APPLE__) && defined(_WIN32)
+        std::atomic<std::size_t> committed_ = 0; // prefix of the buffer
+
+        static constexpr std::size_t commit_step_ = 1 << 20; // 1MiB
+#endif
+
+        void *
+        do_allocate(std::size_t bytes, std::size_t alignment) override
+        {
+                const auto  base = reinterpret_cast<std::uintptr_t>(buffer_);
+                auto        offset = used_.load(std::memory_order_relaxed);
+                std::size_t aligned;
+                do {
+                        aligned = round_up_(base + offset, alignment) - base;
+                        if (aligned + bytes > capacity_)
+                                throw std::bad_alloc();
+                } while (!used_.compare_exchange_weak(
+                    offset, aligned + bytes, std::memory_order_relaxed));
+#if !defined(__unix__) && !defined(__APPLE__) && defined(_WIN32)
+                commit_(aligned + bytes);
+#endif
+                return buffer_ + aligned;
+        }
+
+        void
+        do_deallocate(void *, std::size_t, std::size_t) override
+        {
+                // no-op: released with the arena
+        }
+
+        bool
+        do_is_equal(
+            const std::pmr::memory_resource &other) const noexcept override
+        {
+                return this == &other;
+        }
+
+        // Reserves (without committing) at least `size` bytes.
+        void
+        reserve_(std::size_t size, pages kind)
+        {
+#if defined(__unix__) || defined(__APPLE__)
+                int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_HUGETLB
+                if (kind == pages::explicit_huge) {
+                        // Without MAP_NORESERVE, so that the huge pages are
+                        // reserved now: a short pool fails here, rather than
+                        // with a SIGBUS on first touch.
+                        auto huge_size = round_up_(size, huge_page_size);
+                        mapping_       = mmap(nullptr,
+                                        huge_size,
+                                        PROT_READ | PROT_WRITE,
+                                        flags | MAP_HUGETLB,
+                                        -1,
+                                        0);
+                        if (mapping_ != MAP_FAILED) {
+                                mapping_size_ = huge_size;
+                                buffer_ = static_cast<std::byte *>(mapping_);
+                                return;
+                        }
+                        mapping_ = nullptr; // none available; fall back
+                }
+#endif
+#ifdef MAP_NORESERVE
+                flags |= MAP_NORESERVE;
+#endif
+                // Extra room to align the buffer on a huge page boundary.
+                bool huge     = kind != pages::normal;
+                mapping_size_ = size + (huge ? huge_page_size : 0);
+                mapping_      = mmap(nullptr,
+                                mapping_size_,
+                                PROT_READ | PROT_WRITE,
+                                flags,
+                                -1,
+                                0);
+                if (mapping_ == MAP_FAILED) {
+                        mapping_ = nullptr;
+                        throw std::bad_alloc();
+                }
+                auto address = reinterpret_cast<std::uintptr_t>(mapping_);
+                buffer_      = static_cast<std::byte *>(mapping_)
+                          + (huge ? round_up_(address, huge_page_size) - address
+                                  : 0);
+#ifdef MADV_HUGEPAGE
+                if (huge)
+                        madvise(buffer_, size, MADV_HUGEPAGE);
+#endif
+#elif defined(_WIN32)
+                // Only reserved here; do_allocate commits pages as the
+                // bump pointer reaches them, so the commit charge tracks
+                // the memory handed out. Large pages need a privilege; not
+                // attempted.
+                (void)kind;
+                mapping_size_ = size;
+                mapping_      = VirtualAlloc(
+                    nullptr, size, MEM_RESERVE, PAGE_NOACCESS);
+                if (!mapping_)
+                        throw std::bad_alloc();
+                buffer_ = static_cast<std::byte *>(mapping_);
+#else
+                (void)kind;
+                mapping_size_ = size;
+                mapping_      = ::operator new(size);
+                buffer_       = static_cast<std::byte *>(mapping_);
+#endif
+        }
+
+#if !defined(__unix__) && !defined(__APPLE__) && defined(_WIN32)
+        // Commits the buffer up to at least `end`, a step at a time. Threads
+        // racing here may commit the same pages, which is harmless.
+        void
+        commit_(std::size_t end)
+        {
+                auto committed = committed_.load(std::memory_order_acquire);
+                if (end <= committed)
+                        return;
+                auto target = std::min(round_up_(end, commit_step_),
+                                       mapping_size_);
+                if (!VirtualAlloc(buffer_ + committed,
+                                  target - committed,
+                                  MEM_COMMIT,
+                                  PAGE_READWRITE))
+                        throw std::bad_alloc();
+                while (committed < target
+                       && !committed_.compare_exchange_weak(
+                           committed, target, std::memory_order_release))
+                        ;
+        }
+#endif
+
+        static std::size_t
+        round_up_(std::size_t value, std::size_t multiple) noexcept
+        {
+                return (value + multiple - 1) / multiple * multiple;
+        }
+
+public:
+        explicit arena_memory(std::size_t capacity,
+                              pages       kind = pages::transparent_huge) :
+                capacity_(capacity)
+        {
+                reserve_(std::max<std::size_t>(capacity, 1), kind);
+        }
+        arena_memory(const arena_memory &) = delete;
+        arena_memory(arena_memory &&)      = delete;
+        ~arena_memory()
+        {
+#if defined(__unix__) || defined(__APPLE__)
+                munmap(mapping_, mapping_size_);
+#elif defined(_WIN32)
+                VirtualFree(mapping_, 0, MEM_RELEASE);
+#else
+                ::operator delete(mapping_);
+#endif
+        }
+
+        inline std::size_t
+        capacity() const noexcept
+        {
+                return capacity_;
+        }
+
+        // Bytes handed out so far, alignment padding included.
+        inline std::size_t
+        used() const noexcept
+        {
+                return used_.load(std::memory_order_relaxed);
+        }
+
+        // Whether the pointer lies in the arena.
+        inline bool
+        owns(const void *p) const noexcept
+        {
+                auto *byte = static_cast<const std::byte *>(p);
+                return byte >= buffer_ && byte < buffer_ + capacity_;
+        }
+};
+
+} // namespace mnkg
@@ -0,0 +1,40 @@
+// Test of arena_memory: explicit huge pages fall back to normal ones when the
+// pool is short (e.g. nr_hugepages=0), instead of failing on first touch.
+// Exits with a non-zero status on failure.
+
+#include "varia/arena_memory.hpp"
+
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+int
+main()
+{
+        std::size_t reserved = 0;
+        std::ifstream("/proc/sys/vm/nr_hugepages") >> reserved;
+        if (reserved)
+                std::cout << "note: " << reserved
+                          << " huge pages reserved; the fallback may not be "
+                             "exercised\n";
+
+        constexpr std::size_t size = 4 * mnkg::arena_memory::huge_page_size;
+        auto arena = mnkg::arena_memory(
+            size, mnkg::arena_memory::pages::explicit_huge);
+        auto *bytes = static_cast<std::byte *>(arena.allocate(size, 64));
+        std::memset(bytes, 0xa5, size); // touches every page
+        for (std::size_t i = 0; i < size; i += 4096)
+                if (bytes[i] != std::byte(0xa5) || !arena.owns(bytes + i)) {
+                        std::cerr << "arena_memory_test: bad byte at " << i
+                                  << '\n';
+                        return 1;
+                }
+        if (arena.used() != size) {
+                std::cerr << "arena_memory_test: used " << arena.used()
+                          << " bytes, expected " << size << '\n';
+                return 1;
+        }
+        std::cout << "arena_memory_test: ok\n";
+        return 0;
+}
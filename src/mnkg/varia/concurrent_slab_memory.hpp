@@ -0,0 +1,298 @@
+// Thread-safe counterpart of slab_memory.hpp.
+// Features:
+// - Single memory pool; only manages one block (slab) size, set at
+//   construction (e.g. one instance per size class).
+// - Slabs are obtained from an upstream resource, a batch at a time, and
+//   recycled; they are only given back upstream on destruction.
+// - Lock-free: free slabs are kept in a global stack of batches, with
+//   tagged (ABA-safe) compare-and-swap.
+// - Per-thread caches ("magazines"): each thread may allocate and free
+//   through its own magazine, which only touches the global stack once
+//   per batch of slabs. Magazines are memory resources as well.
+// - No internal fragmentation (disallows small allocations).
+// - Few integrity checks.
+// Made for its use in the performance-critical MCTS module.
+// Speed was prioritized over safety, use with caution.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace mnkg {
+
+class concurrent_slab_memory : public std::pmr::memory_resource {
+public:
+        // Slabs moved at once between magazines and the global stack.
+        static constexpr std::size_t batch_size = 32;
+
+        class magazine;
+
+private:
+        // Overlays free slabs.
+        struct free_slab {
+                free_slab *next;       // in its batch
+                free_slab *next_batch; // in the global stack, if first
+        };
+
+        // Head of the global stack: a pointer, tagged in its unused upper
+        // bits with a counter that changes on every push and pop.
+        using tagged = std::uintptr_t;
+
+        static constexpr int    pointer_bits = 48; // x86-64, AArch64
+        static constexpr tagged pointer_mask
+            = (tagged(1) << pointer_bits) - 1;
+
+        std::size_t                slab_size_;
+        std::size_t                alignment_;
+        std::pmr::memory_resource *upstream_;
+        std::atomic<tagged>        batches_ = 0;
+
+        std::mutex          chunks_mutex_;
+        std::vector<void *> chunks_; // from upstream; see carve_batch_
+
+        static free_slab *
+        pointer_(tagged head) noexcept
+        {
+                return reinterpret_cast<free_slab *>(head & pointer_mask);
+        }
+
+        static tagged
+        tag_(free_slab *batch, tagged previous) noexcept
+        {
+                auto pointer = reinterpret_cast<tagged>(batch);
+                assert((pointer & ~pointer_mask) == 0);
+                auto count = (previous >> pointer_bits) + 1;
+                return (count << pointer_bits) | pointer;
+        }
+
+        // Null if the global stack is empty.
+        free_slab *
+        pop_batch_() noexcept
+        {
+                auto head = batches_.load(std::memory_order_acquire);
+                while (auto *batch = pointer_(head)) {
+                        // May read a batch just popped, and reused, by
+                        // another thread: then the tag changed, and the
+                        // exchange fails.
+                        auto next = tag_(batch->next_batch, head);
+                        if (batches_.compare_exchange_weak(
+                                head, next, std::memory_order_acquire))
+                                return batch;
+                }
+                return nullptr;
+        }
+
+        void
+        push_batch_(free_slab *batch) noexcept
+        {
+                assert(batch);
+                auto head = batches_.load(std::memory_order_relaxed);
+                do
+                        batch->next_batch = pointer_(head);
+                while (!batches_.compare_exchange_weak(
+                    head, tag_(batch, head), std::memory_order_release));
+        }
+
+        // A batch of fresh slabs from upstream; throws if out of memory.
+        free_slab *
+        carve_batch_()
+        {
+                auto *chunk = static_cast<std::byte *>(
+                    upstream_->allocate(slab_size_ * batch_size, alignment_));
+                {
+                        auto lock = std::lock_guard(chunks_mutex_);
+                        chunks_.push_back(chunk);
+                }
+                free_slab *first = nullptr;
+                for (auto i = batch_size; i-- > 0;) {
+                        auto *slab = reinterpret_cast<free_slab *>(
+                            chunk + i * slab_size_);
+                        slab->next = first;
+                        first      = slab;
+                }
+                return first;
+        }
+
+        // A batch of free slabs, recycled if possible.
+        free_slab *
+        take_batch_()
+        {
+                if (auto *batch = pop_batch_())
+                        return batch;
+                return carve_batch_();
+        }
+
+        void *
+        do_allocate(std::size_t bytes, std::size_t alignment) override
+        // Goes through the global stack; prefer magazines.
+        {
+                if (not valid(bytes, alignment))
+                        throw std::bad_alloc();
+                auto *batch = take_batch_();
+                if (batch->next)
+                        push_batch_(batch->next);
+                return batch;
+        }
+
+        void
+        do_deallocate(void *p, std::size_t bytes,
+                      std::size_t alignment) override
+        // Goes through the global stack; prefer magazines.
+        // WARNING: Double free is undefined behavior.
+        {
+                if (!p || !valid(bytes, alignment))
+                        throw std::bad_alloc();
+                auto *slab = static_cast<free_slab *>(p);
+                slab->next = nullptr;
+                push_batch_(slab);
+        }
+
+        inline bool
+        valid(std::size_t bytes, std::size_t alignment) const
+        {
+                bool fits_perfectly = bytes == slab_size_;
+                bool aligned        = (alignment <= alignment_)
+                               && (alignment != 0)
+                               && ((alignment_ % alignment) == 0);
+                return fits_perfectly && aligned;
+        }
+
+        bool
+        do_is_equal(
+            const std::pmr::memory_resource &other) const noexcept override;
+
+public:
+        // Upstream must be thread-safe.
+        concurrent_slab_memory(
+            std::size_t                slab_size,
+            std::pmr::memory_resource *upstream
+            = std::pmr::get_default_resource(),
+            std::size_t alignment = alignof(std::max_align_t)) :
+                slab_size_(slab_size), alignment_(alignment),
+                upstream_(upstream)
+        {
+                assert(slab_size >= sizeof(free_slab));
+                assert(slab_size % alignment == 0);
+                assert(alignment % alignof(free_slab) == 0);
+        }
+        concurrent_slab_memory(const concurrent_slab_memory &) = delete;
+        concurrent_slab_memory(concurrent_slab_memory &&)      = delete;
+        // Magazines must have been destroyed; slabs still in use are freed.
+        ~concurrent_slab_memory()
+        {
+                for (auto *chunk : chunks_)
+                        upstream_->deallocate(
+                            chunk, slab_size_ * batch_size, alignment_);
+        }
+
+        inline std::size_t
+        slab_size() const noexcept
+        {
+                return slab_size_;
+        }
+
+        inline std::size_t
+        alignment() const noexcept
+        {
+                return alignment_;
+        }
+};
+
+// Per-thread cache of free slabs; not thread-safe itself.
+// Holds up to two batches, so that alternating allocations and frees do not
+// bounce batches to the global stack.
+class concurrent_slab_memory::magazine : public std::pmr::memory_resource {
+        concurrent_slab_memory                  *memory_; // non-owning
+        std::array<free_slab *, 2 * batch_size> slabs_;
+        std::size_t                             count_ = 0;
+
+        void
+        refill_()
+        {
+                for (auto *slab = memory_->take_batch_(); slab;
+                     slab       = slab->next)
+                        slabs_[count_++] = slab;
+        }
+
+        void
+        flush_(std::size_t count) noexcept
+        {
+                assert(count > 0 && count <= count_);
+                free_slab *batch = nullptr;
+                for (std::size_t i = 0; i < count; ++i) {
+                        auto *slab = slabs_[--count_];
+                        slab->next = batch;
+                        batch      = slab;
+                }
+                memory_->push_batch_(batch);
+        }
+
+        void *
+        do_allocate(std::size_t bytes, std::size_t alignment) override
+        {
+                if (not memory_->valid(bytes, alignment))
+                        throw std::bad_alloc();
+                if (count_ == 0)
+                        refill_();
+                return slabs_[--count_];
+        }
+
+        void
+        do_deallocate(void *p, std::size_t bytes,
+                      std::size_t alignment) override
+        // WARNING: Double free is undefined behavior.
+        {
+                if (!p || !memory_->valid(bytes, alignment))
+                        throw std::bad_alloc();
+                if (count_ == slabs_.size())
+                        flush_(batch_size);
+                slabs_[count_++] = static_cast<free_slab *>(p);
+        }
+
+        bool
+        do_is_equal(
+            const std::pmr::memory_resource &other) const noexcept override
+        {
+                return memory_->is_equal(other);
+        }
+
+public:
+        explicit magazine(concurrent_slab_memory &memory) : memory_(&memory)
+        {
+        }
+        magazine(const magazine &) = delete;
+        magazine(magazine &&)      = delete;
+        ~magazine()
+        {
+                while (count_ > 0)
+                        flush_(std::min(count_, batch_size));
+        }
+
+        concurrent_slab_memory &
+        memory() const noexcept
+        {
+                return *memory_;
+        }
+};
+
+// Slabs may be freed through any magazine of the same memory.
+inline bool
+concurrent_slab_memory::do_is_equal(
+    const std::pmr::memory_resource &other) const noexcept
+{
+        if (this == &other)
+                return true;
+        auto *cache = dynamic_cast<const magazine *>(&other);
+        return cache && &cache->memory() == this;
+}
+
+} // namespace mnkg
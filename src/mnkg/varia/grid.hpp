@@ -64,8 +64,13 @@ public:
         }
 };
 
+// Anything indexable by position within a bounded size; e.g. grid itself.
 template <typename T, class T_ = std::remove_cvref_t<T> >
-concept grid_c = std::same_as<T_, grid<typename T_::cell> >;
+concept grid_c = requires(const T_ &grid, const T_::position &position) {
+        typename T_::cell;
+        { grid.get_size() } -> std::convertible_to<typename T_::position>;
+        { grid[position] } -> std::convertible_to<typename T_::cell>;
+};
 
 template <grid_c Grid>
 bool
@@ -1,13 +1,14 @@
 // Adapts slab_memory.hpp to be type-oriented (instead of size-oriented)
 // and conform to the "Allocator" named requirement.
-// See slab_memory.hpp.
+// See slab_memory.hpp; also works with concurrent_slab_memory.hpp (or any of
+// its magazines), given a slab size of sizeof(T).
 
 #include "slab_memory.hpp"
 #include <type_traits>
 
 namespace mnkg {
 
-template <typename T>
+template <typename T, class Memory = slab_memory<sizeof(T)> >
 class object_pool_allocator {
 public:
         using value_type      = T;
@@ -15,7 +16,7 @@ public:
         // other traits are defaulted (as in std::allocator_traits<object_pool>)
 
 private:
-        slab_memory<sizeof(T)> *memory_; // non-owning
+        Memory *memory_; // non-owning
 
 public:
         [[nodiscard]] inline T *
@@ -0,0 +1,134 @@
+// Fast pseudo-random generation, for simulations.
+// Features:
+// - xoshiro256**: a small (32 bytes), fast, statistically sound 64-bit
+//   generator; a standard uniform random bit generator. Not cryptographic.
+// - SplitMix64, to expand a seed into a generator's state, or derive
+//   independent seeds (e.g. one per thread) from a single one.
+// - uniform_below: unbiased bounded integers, without modulo nor
+//   distribution objects; usually a single multiplication (Lemire's method).
+
+#pragma once
+
+#include <bit>
+#include <cassert>
+#include <concepts>
+#include <cstdint>
+#include <limits>
+#include <random>
+
+namespace mnkg {
+
+// Next output of SplitMix64, advancing its state.
+constexpr std::uint64_t
+splitmix64(std::uint64_t &state) noexcept
+{
+        auto z = state += 0x9E3779B97F4A7C15;
+        z      = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+        z      = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+        return z ^ (z >> 31);
+}
+
+// Seed of an independent stream (e.g. a thread), derived from a seed.
+constexpr std::uint64_t
+derive_seed(std::uint64_t seed, std::uint64_t stream) noexcept
+{
+        auto state = seed ^ splitmix64(stream);
+        return splitmix64(state);
+}
+
+// Generators made from a 64-bit seed; e.g. std::mt19937_64, xoshiro256.
+template <class Generator>
+concept seedable_generator
+    = std::uniform_random_bit_generator<Generator>
+      && std::constructible_from<Generator, std::uint64_t>;
+
+class xoshiro256 { // xoshiro256** 1.0, by D. Blackman and S. Vigna
+        std::uint64_t state_[4];
+
+public:
+        using result_type = std::uint64_t;
+
+        explicit constexpr xoshiro256(std::uint64_t seed = 0) noexcept
+        {
+                for (auto &word : state_) // never all zero
+                        word = splitmix64(seed);
+        }
+
+        static constexpr result_type
+        min() noexcept
+        {
+                return 0;
+        }
+
+        static constexpr result_type
+        max() noexcept
+        {
+                return std::numeric_limits<result_type>::max();
+        }
+
+        constexpr result_type
+        operator()() noexcept
+        {
+                const auto result = std::rotl(state_[1] * 5, 7) * 9;
+                const auto t      = state_[1] << 17;
+                state_[2] ^= state_[0];
+                state_[3] ^= state_[1];
+                state_[1] ^= state_[2];
+                state_[0] ^= state_[3];
+                state_[2] ^= t;
+                state_[3] = std::rotl(state_[3], 45);
+                return result;
+        }
+};
+
+#ifdef __SIZEOF_INT128__
+__extension__ typedef unsigned __int128 uint128; // GCC, Clang
+#endif
+
+// Lemire's method: the high half of random * bound, redrawn in the rare
+// cases where the low half falls in the biased range. For generators of
+// full-range Words, and Products twice as wide.
+template <class Word, class Product, class Generator>
+std::uint64_t
+lemire_uniform_below(Generator &generator, Word bound)
+{
+        Product product   = Product(Word(generator())) * bound;
+        Word    remainder = Word(product);
+        if (remainder < bound) {
+                const Word threshold = Word(-bound) % bound;
+                while (remainder < threshold) {
+                        product   = Product(Word(generator())) * bound;
+                        remainder = Word(product);
+                }
+        }
+        return std::uint64_t(product >> std::numeric_limits<Word>::digits);
+}
+
+// Uniformly random integer in [0, bound); bound must be positive.
+// Lemire's method for full-range 32 and 64-bit generators; others go
+// through std::uniform_int_distribution.
+template <std::uniform_random_bit_generator Generator>
+std::uint64_t
+uniform_below(Generator &generator, std::uint64_t bound)
+{
+        assert(bound > 0);
+        constexpr auto max   = Generator::max();
+        constexpr auto max32 = std::numeric_limits<std::uint32_t>::max();
+        if constexpr (Generator::min() == 0) {
+                if constexpr (max == max32) {
+                        if (bound <= max32)
+                                return lemire_uniform_below<std::uint32_t,
+                                                            std::uint64_t>(
+                                    generator, std::uint32_t(bound));
+                }
+#ifdef __SIZEOF_INT128__
+                if constexpr (max == std::numeric_limits<std::uint64_t>::max())
+                        return lemire_uniform_below<std::uint64_t, uint128>(
+                            generator, bound);
+#endif
+        }
+        return std::uniform_int_distribution<std::uint64_t>(
+            0, bound - 1)(generator);
+}
+
+} // namespace mnkg
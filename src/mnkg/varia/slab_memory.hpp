@@ -4,24 +4,41 @@
 // - Single memory pool; only manages one block (slab) size.
 // - Consteval slab size.
 // - No resizing (fixed slab count).
+// - Lazy: slabs are reserved as virtual memory and handed out in order (bump
+//   pointer), so pages are only committed once used; see arena_memory.hpp.
+//   Only freed slabs go through a (intrusive) free list.
 // - No internal fragmentation (disallows small allocations).
 // - No thread safety.
 // - Few integrity checks.
 // Made for its use in the performance-critical MCTS module.
 // Speed was prioritized over safety, use with caution.
 
+#pragma once
+
+#include "arena_memory.hpp"
 #include <cstddef>
 #include <memory>
 #include <memory_resource>
-#include <vector>
+#include <stdexcept>
 
 namespace mnkg {
 
 template <std::size_t SlabSize>
 class slab_memory : public std::pmr::memory_resource {
         using slab = std::byte[SlabSize];
-        std::unique_ptr<slab[]> slabs_;
-        std::vector<slab *>     free_;
+
+        // Overlays freed slabs.
+        struct free_slab {
+                free_slab *next;
+        };
+        static_assert(SlabSize >= sizeof(free_slab));
+
+        arena_memory arena_;
+        slab        *slabs_;
+        std::size_t  slab_count_;
+        std::size_t  untouched_   = 0; // first never allocated slab
+        free_slab   *freed_       = nullptr;
+        std::size_t  freed_count_ = 0;
 
         void *
         do_allocate(std::size_t bytes, std::size_t alignment) override
@@ -29,9 +46,13 @@ class slab_memory : public std::pmr::memory_resource {
         {
                 if (not valid(bytes, alignment) || full())
                         throw std::bad_alloc();
-                auto *slab = free_.back();
-                free_.pop_back();
-                return slab;
+                if (freed_) {
+                        auto *slab = freed_;
+                        freed_     = slab->next;
+                        freed_count_--;
+                        return slab;
+                }
+                return slabs_ + untouched_++;
         }
 
         void
@@ -42,7 +63,10 @@ class slab_memory : public std::pmr::memory_resource {
         {
                 if (!valid(p, bytes, alignment))
                         throw std::bad_alloc();
-                free_.push_back(reinterpret_cast<slab *>(p));
+                auto *slab = static_cast<free_slab *>(p);
+                slab->next = freed_;
+                freed_     = slab;
+                freed_count_++;
         }
 
         inline bool
@@ -57,8 +81,8 @@ class slab_memory : public std::pmr::memory_resource {
         inline bool
         valid(void *p, std::size_t bytes, std::size_t alignment) const
         {
-                void *begin    = slabs_.get();
-                void *end      = slabs_.get() + free_.capacity();
+                void *begin    = slabs_;
+                void *end      = slabs_ + slab_count_;
                 bool  in_range = (p >= begin) && (p < end);
                 auto  offset   = reinterpret_cast<uintptr_t>(p)
                               - reinterpret_cast<uintptr_t>(begin);
@@ -74,12 +98,15 @@ class slab_memory : public std::pmr::memory_resource {
         }
 
 public:
-        explicit slab_memory(std::size_t slab_count) :
-                slabs_(std::make_unique<slab[]>(slab_count))
+        explicit slab_memory(std::size_t slab_count,
+                             arena_memory::pages kind
+                             = arena_memory::pages::transparent_huge) :
+                arena_(slab_count * SlabSize, kind),
+                slabs_(static_cast<slab *>(
+                    arena_.allocate(slab_count * SlabSize,
+                                    alignof(std::max_align_t)))),
+                slab_count_(slab_count)
         {
-                free_.reserve(slab_count);
-                for (auto i = 0u; i < slab_count; ++i)
-                        free_.push_back(slabs_.get() + i);
         }
         slab_memory(const slab_memory &) = delete;
         slab_memory(slab_memory &&)      = delete;
@@ -92,25 +119,25 @@ public:
         inline auto
         free_slab_count() const noexcept
         {
-                return free_.size();
+                return slab_count_ - untouched_ + freed_count_;
         }
 
         inline auto
         max_free_slab_count() const noexcept
         {
-                return free_.capacity();
+                return slab_count_;
         }
 
         inline bool
         full() const noexcept
         {
-                return free_.empty();
+                return free_slab_count() == 0;
         }
 
         inline bool
         empty() const noexcept
         {
-                return free_.size() == free_.capacity();
+                return free_slab_count() == slab_count_;
         }
 };
 
@@ -0,0 +1,109 @@
+// Set of small unsigned integers, with O(1) insertion, removal, lookup and
+// random access; a.k.a. "sparse set" (dense array plus index map).
+// Features:
+// - Consteval capacity; elements must be lower than it.
+// - Inline storage: no heap allocation; copying is a plain memory copy.
+// - Contiguous elements, exposed as a span (unspecified order).
+// - Removal reorders (swaps the last element into the hole).
+
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+
+namespace mnkg {
+
+template <std::size_t Capacity, typename Index = std::uint16_t>
+requires(Capacity <= std::numeric_limits<Index>::max()) class sparse_set {
+public:
+        using value_type = Index;
+
+private:
+        std::array<Index, Capacity> dense_  = {}; // elements, in [0, size_)
+        std::array<Index, Capacity> sparse_ = {}; // element -> index in dense_
+        Index                       size_   = 0;
+
+public:
+        sparse_set() = default;
+
+        static consteval std::size_t
+        capacity() noexcept
+        {
+                return Capacity;
+        }
+
+        std::size_t
+        size() const noexcept
+        {
+                return size_;
+        }
+
+        bool
+        empty() const noexcept
+        {
+                return size_ == 0;
+        }
+
+        inline bool
+        contains(Index value) const noexcept
+        {
+                assert(value < Capacity);
+                auto i = sparse_[value];
+                return i < size_ && dense_[i] == value;
+        }
+
+        inline void
+        insert(Index value) noexcept
+        {
+                assert(!contains(value));
+                sparse_[value]  = size_;
+                dense_[size_++] = value;
+        }
+
+        inline void
+        erase(Index value) noexcept
+        {
+                assert(contains(value));
+                auto i        = sparse_[value];
+                auto last     = dense_[--size_];
+                dense_[i]     = last;
+                sparse_[last] = i;
+        }
+
+        inline void
+        clear() noexcept
+        {
+                size_ = 0;
+        }
+
+        inline Index
+        operator[](std::size_t i) const noexcept
+        {
+                assert(i < size_);
+                return dense_[i];
+        }
+
+        std::span<const Index>
+        span() const noexcept
+        {
+                return { dense_.data(), size_ };
+        }
+
+        auto
+        begin() const noexcept
+        {
+                return span().begin();
+        }
+
+        auto
+        end() const noexcept
+        {
+                return span().end();
+        }
+};
+
+} // namespace mnkg
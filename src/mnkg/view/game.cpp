@@ -12,11 +12,13 @@
 #include <SFML/Graphics/VertexArray.hpp>
 #include <SFML/Graphics/View.hpp>
 #include <SFML/System/Angle.hpp>
+#include <SFML/System/Sleep.hpp>
 #include <SFML/System/Vector2.hpp>
 #include <SFML/Window/ContextSettings.hpp>
 #include <SFML/Window/Mouse.hpp>
 #include <SFML/Window/VideoMode.hpp>
 #include <SFML/Window/WindowEnums.hpp>
+#include <mutex>
 
 namespace mnkg::view {
 
@@ -35,6 +37,9 @@ static const sf::ContextSettings antialiasing{
 
 static constexpr sf::Vector2u cell_viewport_size = { 128u, 128u };
 
+// Of the event loop; which sleeps in between, leaving the cores to the AI.
+static const auto frame_period = sf::seconds(1.f / 60);
+
 struct board {
         const point<unsigned int, 2> grid_size;
 
@@ -308,6 +313,10 @@ private:
         struct {
                 sf::RenderTexture game, overlay;
         } renders_;
+        struct {
+                std::mutex                          mutex;
+                std::vector<std::function<void()> > queue;
+        } tasks_; // posted
 
 public:
         implementation(const struct settings &settings) :
@@ -407,6 +416,13 @@ void main()
                 stone_skin_index_ = index;
         }
 
+        void
+        post(std::function<void()> task)
+        {
+                auto lock = std::lock_guard(tasks_.mutex);
+                tasks_.queue.push_back(std::move(task));
+        }
+
         void
         run()
         {
@@ -449,9 +465,12 @@ void main()
                             }
                     };
 
-                while (window_.isOpen())
+                while (window_.isOpen()) {
                         window_.handleEvents(
                             on_close, on_move, on_left, on_entered, on_click);
+                        run_posted_tasks_();
+                        sf::sleep(frame_period);
+                }
         }
 
 private:
@@ -486,6 +505,19 @@ private:
                        != selectable_cells_.end();
         }
 
+        void
+        run_posted_tasks_()
+        {
+                auto tasks = std::vector<std::function<void()> >();
+                {
+                        auto lock = std::lock_guard(tasks_.mutex);
+                        tasks.swap(tasks_.queue);
+                }
+                for (auto &task : tasks)
+                        if (window_.isOpen())
+                                task();
+        }
+
         void
         render_background_()
         {
@@ -565,4 +597,10 @@ game::highlight_stone(point<int, 2> cell_coords)
         pimpl_->highlight_stone(cell_coords);
 }
 
+void
+game::post(std::function<void()> task)
+{
+        pimpl_->post(std::move(task));
+}
+
 } // namespace mnkg::view
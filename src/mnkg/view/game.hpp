@@ -1,6 +1,7 @@
 #pragma once
 
 #include "varia/point.hpp"
+#include <functional>
 #include <memory>
 
 namespace mnkg::view {
@@ -44,6 +45,11 @@ public:
         void
         highlight_stone(point<int, 2> cell_coords);
 
+        // Runs the task on the thread running the window, between frames.
+        // Thread-safe; e.g. for results of background work.
+        void
+        post(std::function<void()> task);
+
 private:
         class implementation;
         std::unique_ptr<implementation> pimpl_;